@@ -0,0 +1,113 @@
+#ifndef ANOMALYDETECTOR_H
+#define ANOMALYDETECTOR_H
+
+#include <QMetaType>
+#include <QString>
+#include "Timestamp.h"
+
+/**
+ * @brief One anomaly found in a completed time-series interval
+ */
+struct AnomalyAlert {
+    enum Type {
+        TrafficSpike,                // Packet count far above its baseline
+        PortScan,                    // Burst of new destination ports from one source
+        SynFlood                     // Handshakes opened far faster than answered
+    };
+
+    enum Scope {
+        Capture,
+        Protocol,
+        Endpoint
+    };
+
+    Type type;
+    Scope scope;
+    QString subject;                 // Protocol name or address; empty for the capture
+    qint64 intervalStartUs;          // Microseconds since epoch
+    double observed;                 // Count in the interval
+    double expected;                 // Baseline mean, or the answered handshakes for SynFlood
+    double score;                    // z-score, or unanswered SYNs per answered one
+
+    AnomalyAlert() : type(TrafficSpike), scope(Capture), intervalStartUs(InvalidTimestamp),
+                     observed(0.0), expected(0.0), score(0.0) {}
+};
+
+Q_DECLARE_METATYPE(AnomalyAlert)
+
+/**
+ * @brief Scoring rules for streaming anomaly detection
+ *
+ * Each monitored count (packets per interval for the capture, a protocol or
+ * an endpoint; new destination ports per interval for a source) has a
+ * Baseline: an exponentially weighted mean and variance that cost O(1) to
+ * update. A completed interval is scored against the baseline built from
+ * the intervals before it, then folded in.
+ *
+ * The detector holds only settings; baselines live with the statistics they
+ * describe, so they are dropped when an endpoint is evicted.
+ */
+class AnomalyDetector {
+public:
+    struct Settings {
+        double smoothing;            // EWMA weight of the newest interval
+        double threshold;            // z-score that raises an alert
+        int warmupIntervals;         // Intervals observed before a baseline can alert
+        quint64 minimumPackets;      // Spikes below this count are ignored
+        quint64 minimumScanPorts;    // New destination ports per interval for a scan
+        quint64 minimumSyns;         // SYNs per interval before a flood is considered
+        double synFloodRatio;        // Unanswered SYNs per SYN-ACK for a flood
+
+        Settings() : smoothing(0.1), threshold(4.0), warmupIntervals(10), minimumPackets(100),
+                     minimumScanPorts(20), minimumSyns(100), synFloodRatio(3.0) {}
+    };
+
+    struct Baseline {
+        double mean;
+        double variance;
+        quint32 intervals;           // Intervals folded in, saturating
+
+        Baseline() : mean(0.0), variance(0.0), intervals(0) {}
+    };
+
+    explicit AnomalyDetector(const Settings &settings = Settings());
+
+    void setSettings(const Settings &settings) { m_settings = settings; }
+    const Settings &settings() const { return m_settings; }
+
+    /**
+     * @brief Score an interval's count against @p baseline, then fold it in
+     *
+     * Returns true and fills @p alert as a TrafficSpike, scope aside, when
+     * the count is at least @p minimum and the threshold above the mean of a
+     * warmed-up baseline.
+     */
+    bool observe(Baseline &baseline, quint64 count, quint64 minimum, AnomalyAlert *alert) const;
+
+    /**
+     * @brief Fold @p intervals empty intervals into @p baseline
+     *
+     * At most warmupIntervals zeros are folded, so a long gap costs a bounded
+     * amount and leaves a baseline that has decayed but not reset.
+     */
+    void observeIdle(Baseline &baseline, qint64 intervals) const;
+
+    /**
+     * @brief Port scan test for the new destination ports one source used
+     *
+     * A burst of at least minimumScanPorts alerts when it is also a spike
+     * against the source's baseline, or while the baseline is still warming
+     * up, so a scanner does not teach itself as normal.
+     */
+    bool observeScan(Baseline &baseline, quint64 newPorts, AnomalyAlert *alert) const;
+
+    // SYNs without ACK sent to an endpoint against the SYN-ACKs it returned
+    bool observeHandshakes(quint64 syns, quint64 synAcks, AnomalyAlert *alert) const;
+
+private:
+    double fold(Baseline &baseline, double value) const;  // Returns the prior z-score
+
+    Settings m_settings;
+};
+
+#endif // ANOMALYDETECTOR_H
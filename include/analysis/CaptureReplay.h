@@ -0,0 +1,134 @@
+#ifndef CAPTUREREPLAY_H
+#define CAPTUREREPLAY_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QString>
+#include <QVector>
+#include <memory>
+#include "../models/PacketModel.h"
+
+/**
+ * @brief One captured frame, decoded in place inside the mapped file
+ *
+ * Holds offsets into the frame rather than copies, so reading a view costs
+ * no allocation. Views stay valid while the CaptureReplay that produced
+ * them is open.
+ */
+struct PacketView {
+    const uchar *data;               // Captured bytes
+    quint32 capturedLength;
+    quint32 originalLength;          // Length on the wire
+    qint64 timestampUs;              // Microseconds since epoch
+    quint64 number;                  // 1-based record number
+    quint16 linkType;                // LINKTYPE_* of the capturing interface
+
+    // Decoded headers
+    quint16 etherType;               // 0 if the link layer was not recognised
+    quint8 ipVersion;                // 4, 6, or 0 if not IP
+    quint8 ipProtocol;               // IPv4 protocol / final IPv6 next header
+    int ipOffset;                    // -1 if not IP
+    int transportOffset;             // -1 if not reached (e.g. later fragments)
+    quint16 srcPort;
+    quint16 dstPort;
+    bool truncated;                  // Headers cut short by the snap length
+
+    PacketView() : data(nullptr), capturedLength(0), originalLength(0), timestampUs(0),
+                   number(0), linkType(0), etherType(0), ipVersion(0), ipProtocol(0),
+                   ipOffset(-1), transportOffset(-1), srcPort(0), dstPort(0),
+                   truncated(false) {}
+
+    const uchar *srcAddress() const { return data + ipOffset + (ipVersion == 4 ? 12 : 8); }
+    const uchar *dstAddress() const { return data + ipOffset + (ipVersion == 4 ? 16 : 24); }
+};
+
+/**
+ * @brief Memory-mapped reader for pcap and pcapng capture files
+ *
+ * The file is mapped once and records are parsed where they lie, so an
+ * offline capture can be fed to StatisticsEngine and ConversationTracker
+ * at close to disk speed. Both microsecond and nanosecond pcap, either
+ * byte order, and pcapng with multiple sections and interfaces are read.
+ * Ethernet (with VLAN tags), Linux cooked (v1 and v2), raw IP and BSD
+ * loopback frames are decoded down to the TCP/UDP ports.
+ *
+ * readBatch() turns views into PacketModels for the engines. Address and
+ * protocol strings are shared from a cache and rawData aliases the
+ * mapping, so the per-packet cost is the PacketModel itself. Keep the
+ * reader open for as long as any of those packets are in use.
+ */
+class CaptureReplay {
+public:
+    enum Format { UnknownFormat, Pcap, PcapNg };
+    enum { DefaultBatchSize = 4096 };
+
+    explicit CaptureReplay(const QString &filePath);
+    ~CaptureReplay();
+
+    bool open();
+    void close();
+    bool isOpen() const { return m_data != nullptr; }
+    QString errorString() const { return m_error; }   // Set when open() or reading fails
+
+    Format format() const { return m_format; }
+    qint64 size() const { return m_size; }
+    qint64 position() const { return m_pos; }
+    quint64 packetCount() const { return m_packetCount; }
+
+    /**
+     * @brief Read the next record
+     * @return false at the end of the file or on a malformed record
+     */
+    bool next(PacketView *view);
+    int readViews(QVector<PacketView> *views, int maxCount = DefaultBatchSize);
+
+    /**
+     * @brief Read up to @p maxCount packets as PacketModels for the engines
+     *
+     * PacketModel::timestamp only keeps milliseconds; @p timestampsUs, if
+     * given, receives each packet's full capture time for the engines'
+     * addPackets().
+     * @return An empty list at the end of the file
+     */
+    QList<std::shared_ptr<PacketModel>> readBatch(int maxCount = DefaultBatchSize,
+                                                  QVector<qint64> *timestampsUs = nullptr);
+    std::shared_ptr<PacketModel> toPacket(const PacketView &view);
+
+private:
+    struct Interface {
+        quint16 linkType;
+        quint8 timestampResolution;  // pcapng if_tsresol
+    };
+
+    bool readFileHeader();
+    bool nextPcap(PacketView *view);
+    bool nextPcapNg(PacketView *view);
+    void readInterface(const uchar *body, quint32 length);
+    quint16 read16(const uchar *p) const;
+    quint32 read32(const uchar *p) const;
+    bool fail(const QString &error);
+
+    static void decode(PacketView *view);
+    const QString &addressName(const PacketView &view, const uchar *address);
+
+    QFile m_file;
+    uchar *m_data;                   // Mapping of the whole file
+    qint64 m_size;
+    qint64 m_pos;
+    Format m_format;
+    bool m_bigEndian;                // Byte order of the current file/section
+    bool m_nanosecond;               // pcap timestamp fraction in nanoseconds
+    quint16 m_linkType;              // pcap link type
+    QVector<Interface> m_interfaces; // pcapng interfaces of the current section
+    qint64 m_lastTimestampUs;        // For pcapng simple packet blocks
+    quint64 m_packetCount;
+    QString m_error;
+
+    // Address strings, formatted once per distinct address
+    QHash<quint32, QString> m_ipv4Names;
+    QHash<QPair<quint64, quint64>, QString> m_ipv6Names;
+};
+
+#endif // CAPTUREREPLAY_H
@@ -0,0 +1,143 @@
+#ifndef CONVERSATIONTABLE_H
+#define CONVERSATIONTABLE_H
+
+#include <QHash>
+#include <QList>
+#include <QVector>
+#include "ConversationTracker.h"
+
+/**
+ * @brief Slot-based conversation storage with O(1) LRU and timeout expiry
+ *
+ * Conversations live in slabs of slots addressed by stable indices; the
+ * flow-key index maps to a slot and freed slots are reused, so churn does
+ * not fragment the heap. Each slot is split in two:
+ *  - a hot part, one cache line, with the per-packet counters and the
+ *    list links below;
+ *  - a cold part with the descriptive Conversation record (addresses, ID,
+ *    packet numbers, TCP flags, metadata).
+ *
+ * The hot part is threaded on two intrusive lists:
+ *  - an LRU list ordered by last touch, so capacity eviction pops the head;
+ *  - a hashed timing wheel (one-second ticks) bucketed by expiry time, so
+ *    timeout expiry only visits the buckets the clock has passed.
+ */
+class ConversationTable {
+public:
+    static const quint32 InvalidSlot = 0xFFFFFFFFu;
+
+    ConversationTable();
+
+    int size() const { return m_index.size(); }
+    bool isEmpty() const { return m_index.isEmpty(); }
+    void clear();
+
+    /**
+     * @brief Per-packet state of a conversation
+     */
+    struct Counters {
+        quint64 packetsAtoB;
+        quint64 packetsBtoA;
+        quint64 bytesAtoB;
+        quint64 bytesBtoA;
+        qint64 endTimeUs;
+
+        Counters() : packetsAtoB(0), packetsBtoA(0), bytesAtoB(0), bytesBtoA(0),
+                     endTimeUs(InvalidTimestamp) {}
+    };
+
+    quint32 find(const FlowKey &key) const { return m_index.value(key, InvalidSlot); }
+    quint32 insert(const FlowKey &key, const Conversation &conv, qint64 expirySecs);
+    void remove(quint32 slot);
+
+    Counters &counters(quint32 slot) { return m_hot[slot].counters; }
+    const Counters &counters(quint32 slot) const { return m_hot.at(slot).counters; }
+
+    // Descriptive fields only; the counters, end time and duration are not kept here
+    Conversation &details(quint32 slot) { return m_cold[slot].conv; }
+    const Conversation &details(quint32 slot) const { return m_cold.at(slot).conv; }
+    const FlowKey &keyAt(quint32 slot) const { return m_cold.at(slot).key; }
+    quint8 &inspectedPayloads(quint32 slot, bool aToB) {
+        return m_cold[slot].inspectedPayloads[aToB ? 0 : 1];
+    }
+
+    // The complete record, assembled from both parts
+    Conversation conversation(quint32 slot) const;
+    void assemble(quint32 slot, Conversation *conv) const;  // Into a reused record
+    void replace(quint32 slot, const Conversation &conv);
+
+    // Slots in storage order; a live conversation never changes slot
+    quint32 slotCount() const { return static_cast<quint32>(m_cold.size()); }
+    bool isUsed(quint32 slot) const { return m_cold.at(slot).used; }
+
+    /**
+     * @brief Mark a conversation as most recently used and reschedule its expiry
+     */
+    void touch(quint32 slot, qint64 expirySecs);
+
+    quint32 leastRecentlyUsed() const { return m_lruHead; }
+
+    /**
+     * @brief Advance the wheel to @p nowSecs and return slots that have expired
+     */
+    QList<quint32> collectExpired(qint64 nowSecs);
+
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        Conversation conv;
+        for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+            assemble(it.value(), &conv);
+            fn(conv);
+        }
+    }
+
+    template <typename Fn>
+    void forEachEntry(Fn fn) const {
+        Conversation conv;
+        for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+            assemble(it.value(), &conv);
+            fn(it.key(), conv);
+        }
+    }
+
+private:
+    enum { WheelSize = 512 };        // Buckets of one second each
+
+    struct alignas(64) HotSlot {
+        Counters counters;
+        qint64 expirySecs;
+        quint32 lruPrev;
+        quint32 lruNext;
+        quint32 wheelPrev;
+        quint32 wheelNext;
+
+        HotSlot() : expirySecs(0), lruPrev(InvalidSlot), lruNext(InvalidSlot),
+                    wheelPrev(InvalidSlot), wheelNext(InvalidSlot) {}
+    };
+
+    struct ColdSlot {
+        Conversation conv;
+        FlowKey key;
+        bool used;
+        quint8 inspectedPayloads[2]; // Payloads given to the protocol classifier, A to B and B to A
+
+        ColdSlot() : used(false), inspectedPayloads{0, 0} {}
+    };
+
+    void lruUnlink(quint32 slot);
+    void lruAppend(quint32 slot);
+    void wheelUnlink(quint32 slot);
+    void wheelInsert(quint32 slot);
+    static int wheelBucket(qint64 secs);         // Floor modulo, so pre-1970 times fit
+
+    QHash<FlowKey, quint32> m_index;
+    QVector<HotSlot> m_hot;                      // Index: slot
+    QVector<ColdSlot> m_cold;                    // Index: slot
+    QVector<quint32> m_freeSlots;
+    quint32 m_lruHead;                           // Least recently used
+    quint32 m_lruTail;                           // Most recently used
+    QVector<quint32> m_wheel;                    // Bucket heads
+    qint64 m_wheelCursor;                        // Last second processed, -1 = not started
+};
+
+#endif // CONVERSATIONTABLE_H
@@ -6,11 +6,23 @@
 #include <QList>
 #include <QDateTime>
 #include <QMutex>
+#include <QStringList>
+#include <QVector>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include "../models/PacketModel.h"
+#include "FlowKey.h"
+#include "PacketNumberList.h"
+#include "SymbolTable.h"
+#include "Timestamp.h"
 
 // Forward declarations
+class ConversationTable;
 class StreamReassembler;
+class TcpAnalyzer;
+struct TcpHeader;
+class QTimer;
 
 /**
  * @brief Represents a network conversation between two endpoints
@@ -22,6 +34,7 @@ struct Conversation {
     quint16 portA;                   // First endpoint port
     QString addressB;                // Second endpoint address
     quint16 portB;                   // Second endpoint port
+    bool aIsHighEndpoint;            // A is the high side of the flow key
     
     // Statistics
     quint64 packetsAtoB;            // Packets from A to B
@@ -30,12 +43,12 @@ struct Conversation {
     quint64 bytesBtoA;              // Bytes from B to A
     
     // Timing
-    QDateTime startTime;             // First packet time
-    QDateTime endTime;               // Last packet time
+    qint64 startTimeUs;              // First packet time, microseconds since epoch
+    qint64 endTimeUs;                // Last packet time
     double duration;                 // Duration in seconds
     
     // Packet references
-    QList<quint64> packetNumbers;    // All packet numbers in conversation
+    PacketNumberList packetNumbers;  // All packet numbers in conversation (compressed)
     quint64 firstPacketNum;          // First packet number
     quint64 lastPacketNum;           // Last packet number
     
@@ -51,11 +64,67 @@ struct Conversation {
     QString applicationProtocol;     // Detected app protocol (HTTP, DNS, etc.)
     QHash<QString, QVariant> metadata; // Additional metadata
     
-    Conversation() : portA(0), portB(0), packetsAtoB(0), packetsBtoA(0),
-                     bytesAtoB(0), bytesBtoA(0), duration(0.0),
+    Conversation() : portA(0), portB(0), aIsHighEndpoint(false),
+                     packetsAtoB(0), packetsBtoA(0),
+                     bytesAtoB(0), bytesBtoA(0), startTimeUs(InvalidTimestamp),
+                     endTimeUs(InvalidTimestamp), duration(0.0),
                      firstPacketNum(0), lastPacketNum(0), isTcpComplete(false),
                      hasSyn(false), hasFin(false), hasRst(false),
                      synPacketNum(0), finPacketNum(0) {}
+
+    QDateTime startTime() const { return dateTimeFromUs(startTimeUs); }
+    QDateTime endTime() const { return dateTimeFromUs(endTimeUs); }
+};
+
+/**
+ * @brief Round-trip time estimate between the capture point and one host
+ *
+ * Samples time a segment to the ACK that covers it, so they include the
+ * peer's ACK delay. Segments that were retransmitted are not sampled, nor
+ * are round trips below the capture's timestamp resolution.
+ */
+struct TcpRttStats {
+    quint64 samples;
+    qint64 minUs;                    // -1 until the first sample
+    qint64 maxUs;
+    qint64 smoothedUs;               // RFC 6298 SRTT
+    qint64 variationUs;              // RFC 6298 RTTVAR
+    qint64 lastUs;
+
+    TcpRttStats() : samples(0), minUs(-1), maxUs(-1), smoothedUs(-1), variationUs(-1),
+                    lastUs(-1) {}
+};
+
+/**
+ * @brief TCP performance counters for one direction of a stream
+ */
+struct TcpDirectionMetrics {
+    TcpRttStats rtt;                 // Segments sent this way, timed to the peer's ACK
+    quint64 goodputBytes;            // Sequence space acknowledged by the peer, counted once
+    quint64 retransmissions;
+    quint64 outOfOrder;
+    quint64 duplicateAcks;           // Duplicate ACKs sent this way
+    quint64 zeroWindows;             // Times a zero receive window was advertised
+
+    TcpDirectionMetrics() : goodputBytes(0), retransmissions(0), outOfOrder(0),
+                            duplicateAcks(0), zeroWindows(0) {}
+};
+
+/**
+ * @brief TCP performance metrics of a stream, measured at the capture point
+ */
+struct TcpMetrics {
+    qint64 handshakeRttUs;           // SYN to the ACK of the SYN-ACK, -1 if not timed
+    TcpDirectionMetrics client;      // Client to server; rtt is capture point to server
+    TcpDirectionMetrics server;      // Server to client; rtt is capture point to client
+
+    // Goodput of both directions in consecutive intervals from the stream
+    // start. The interval doubles whenever the series would outgrow its
+    // fixed number of buckets, so it covers the whole stream.
+    qint64 goodputIntervalUs;
+    QVector<quint64> goodput;        // Bytes per interval
+
+    TcpMetrics() : handshakeRttUs(-1), goodputIntervalUs(0) {}
 };
 
 /**
@@ -70,6 +139,7 @@ struct TcpStream {
     quint16 clientPort;
     QString serverAddress;
     quint16 serverPort;
+    bool clientIsHighEndpoint;       // Client is the high side of the flow key
     
     // Stream data
     QByteArray clientData;           // Data from client to server
@@ -92,18 +162,40 @@ struct TcpStream {
     quint64 serverPackets;
     quint64 clientBytes;
     quint64 serverBytes;
-    quint64 retransmissions;
+    quint64 retransmissions;         // Both directions; see metrics for each
     quint64 outOfOrder;
+    TcpMetrics metrics;
     
     // Timing
-    QDateTime startTime;
-    QDateTime endTime;
+    qint64 startTimeUs;              // Microseconds since epoch
+    qint64 endTimeUs;
     
     TcpStream() : streamIndex(0), clientPort(0), serverPort(0),
+                  clientIsHighEndpoint(false),
                   clientInitSeq(0), serverInitSeq(0), clientNextSeq(0),
                   serverNextSeq(0), isComplete(false), hasGaps(false),
                   clientPackets(0), serverPackets(0), clientBytes(0),
-                  serverBytes(0), retransmissions(0), outOfOrder(0) {}
+                  serverBytes(0), retransmissions(0), outOfOrder(0),
+                  startTimeUs(InvalidTimestamp), endTimeUs(InvalidTimestamp) {}
+
+    QDateTime startTime() const { return dateTimeFromUs(startTimeUs); }
+    QDateTime endTime() const { return dateTimeFromUs(endTimeUs); }
+};
+
+/**
+ * @brief Resumable position for paging through conversations
+ *
+ * Pages follow storage order, in which a live conversation never moves, so
+ * no conversation is returned twice; conversations created behind the
+ * cursor after it has passed are not returned.
+ */
+struct ConversationCursor {
+    int shard;
+    quint32 slot;
+
+    ConversationCursor() : shard(0), slot(0) {}
+
+    bool atEnd() const { return shard < 0; }
 };
 
 /**
@@ -118,15 +210,44 @@ public:
 
     // Conversation management
     void addPacket(const std::shared_ptr<PacketModel> &packet);
+    // One lock per shard. Updates are reported by one conversationsBatchUpdated()
+    // per batch; added, completed and stream lifecycle signals are still emitted.
+    // timestampsUs as for StatisticsEngine::addPackets()
+    void addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                    const QVector<qint64> &timestampsUs = QVector<qint64>());
     void clear();
     void reset();
 
+    /**
+     * @brief Fold the conversations and streams of another tracker into this one
+     *
+     * Used to combine partitions of one capture analysed by separate
+     * trackers. A flow present in both is stitched into one conversation
+     * (and one TCP stream) whose orientation is taken from the side that saw
+     * it first; other flows are copied over with new stream indices.
+     */
+    void merge(const ConversationTracker &other);
+
     // Conversation queries
     QList<Conversation> getAllConversations() const;
     QList<Conversation> getConversationsByProtocol(const QString &protocol) const;
     Conversation getConversation(const QString &conversationId) const;
     QString getConversationId(const std::shared_ptr<PacketModel> &packet) const;
     QList<quint64> getConversationPackets(const QString &conversationId) const;
+    QList<quint64> getConversationPackets(const QString &conversationId, int offset,
+                                          int count) const; // Decodes only the requested page
+
+    // Views without building result lists. Visitors run under one shard lock
+    // at a time, see records in place and return false to stop; they must
+    // not call back into the tracker. A page takes each shard lock briefly,
+    // so ingest proceeds between pages.
+    typedef std::function<bool(const Conversation &)> ConversationVisitor;
+    typedef std::function<bool(const TcpStream &)> TcpStreamVisitor;
+    void visitConversations(const ConversationVisitor &visitor) const;
+    void visitTcpStreams(const TcpStreamVisitor &visitor) const;
+    bool visitConversationPackets(const QString &conversationId,
+                                  const std::function<bool(quint64)> &visitor) const;
+    QList<Conversation> getConversationPage(ConversationCursor *cursor, int count) const;
 
     // Conversation filtering
     QList<Conversation> filterConversations(const QString &address) const;
@@ -141,7 +262,9 @@ public:
     TcpStream getTcpStreamForPacket(const std::shared_ptr<PacketModel> &packet) const;
     quint32 getTcpStreamIndex(const std::shared_ptr<PacketModel> &packet) const;
     
-    // TCP stream reassembly
+    // TCP stream reassembly. On a live stream the data is a read-only view
+    // with the holes left out and listed as gaps, so later segments can
+    // still fill them; once the stream has closed the holes are declared lost
     bool reassembleTcpStream(quint32 streamIndex);
     QByteArray getStreamData(quint32 streamIndex, bool clientToServer) const;
     bool exportStreamData(quint32 streamIndex, const QString &filePath, bool clientToServer) const;
@@ -159,6 +282,24 @@ public:
     void setEnableStreamReassembly(bool enable);
     void setMaxStreamSize(quint64 maxBytes);
 
+    // Sharding: flows are partitioned by a symmetric hash into independent
+    // shards, each with its own tables and lock. Changing the shard count
+    // clears all state, so configure it before ingest starts.
+    void setShardCount(int count);
+    int getShardCount() const;
+    int getShardForPacket(const std::shared_ptr<PacketModel> &packet) const;
+    // Skip shard locks on ingest. Only valid when every shard is fed by a
+    // single owning thread and queries are made while ingest is paused.
+    // Ignored while a notification interval is set.
+    void setLockFreeIngest(bool enable);
+
+    // With a non-zero interval, per-packet signals are replaced by one
+    // conversationsBatchUpdated() per interval, emitted from this object's thread
+    // together with the added, completed and stream lifecycle signals it covers.
+    // The timer reads shard state during ingest, so a non-zero interval is
+    // ignored while lock-free ingest is on.
+    void setNotificationInterval(int intervalMs);
+
 signals:
     void conversationAdded(const QString &conversationId);
     void conversationUpdated(const QString &conversationId);
@@ -166,6 +307,8 @@ signals:
     void tcpStreamCreated(quint32 streamIndex);
     void tcpStreamUpdated(quint32 streamIndex);
     void tcpStreamComplete(quint32 streamIndex);
+    void conversationsBatchUpdated(const QStringList &conversationIds,
+                                   const QList<quint32> &streamIndices);
     void statisticsUpdated();
 
 private:
@@ -174,38 +317,79 @@ private:
                                    const QString &addrB, quint16 portB) const;
     QString normalizeConversationKey(const QString &addrA, quint16 portA,
                                     const QString &addrB, quint16 portB) const;
+    bool parseConversationId(const QString &conversationId, QString *protocol,
+                             FlowKey *key) const;
+
+    struct Shard;
+    struct PacketEvents;
+    struct LifecycleEvents;
+
+    // Ingest (caller holds the shard lock)
+    void ingestPacket(Shard &shard, FlowKey key, bool reversed,
+                      const std::shared_ptr<PacketModel> &packet, qint64 packetUs,
+                      PacketEvents &events);
+    void publishPendingUpdates();
+    void emitBatch(const LifecycleEvents &lifecycle, const QStringList &conversationIds,
+                   const QList<quint32> &streamIndices);
+
+    // Flow keys and sharding
+    int shardOf(const FlowKey &key) const;
+    int shardOfStream(quint32 streamIndex) const;
+    quint64 shardConversationLimit() const;
+    bool resolveProtocol(const QString &protocol, FlowKey *key) const;
 
     // Conversation tracking
-    void updateConversation(const QString &convId, const std::shared_ptr<PacketModel> &packet);
+    void updateConversation(ConversationTable &table, quint32 slot, bool reversed,
+                            const std::shared_ptr<PacketModel> &packet, qint64 timeUs,
+                            const TcpHeader &tcp, PacketEvents &events);
+    void classifyConversation(ConversationTable &table, quint32 slot, bool isAtoB,
+                              const std::shared_ptr<PacketModel> &packet, const TcpHeader &tcp);
     void detectApplicationProtocol(Conversation &conv, const std::shared_ptr<PacketModel> &packet);
-    void updateTcpState(Conversation &conv, const std::shared_ptr<PacketModel> &packet);
+    void updateTcpState(Conversation &conv, const std::shared_ptr<PacketModel> &packet,
+                        const TcpHeader &tcp, PacketEvents &events);
     
     // TCP stream handling
-    void processTcpPacket(const std::shared_ptr<PacketModel> &packet);
-    quint32 getOrCreateTcpStream(const std::shared_ptr<PacketModel> &packet);
-    void addTcpSegment(TcpStream &stream, const std::shared_ptr<PacketModel> &packet);
-    void detectTcpFlags(TcpStream &stream, const std::shared_ptr<PacketModel> &packet);
-    bool isRetransmission(const TcpStream &stream, quint32 seq, quint32 len, bool clientToServer) const;
+    void processTcpPacket(Shard &shard, const FlowKey &key, bool reversed, const QString &convId,
+                          const std::shared_ptr<PacketModel> &packet, qint64 timeUs,
+                          const TcpHeader &tcp, PacketEvents &events);
+    quint32 getOrCreateTcpStream(Shard &shard, const FlowKey &key, bool reversed,
+                                 const QString &convId,
+                                 const std::shared_ptr<PacketModel> &packet, qint64 timeUs,
+                                 PacketEvents &events);
+    void addTcpSegment(TcpStream &stream, StreamReassembler &client, StreamReassembler &server,
+                       TcpAnalyzer &analyzer, bool clientToServer, const std::shared_ptr<PacketModel> &packet, qint64 timeUs,
+                       const TcpHeader &tcp);
+    void detectTcpFlags(TcpStream &stream, const TcpHeader &tcp, PacketEvents &events);
+
+    QList<Conversation> topConversations(int count, bool byBytes) const;
+
+    // Partition merging (caller holds the shard lock)
+    void mergeConversation(Shard &shard, const FlowKey &key, const Conversation &from);
+    void mergeTcpStream(Shard &shard, const FlowKey &key, const TcpStream &from,
+                        const StreamReassembler &fromClient, const StreamReassembler &fromServer);
 
     // Cleanup
     void cleanupOldConversations();
-    void enforceConversationLimit();
+    void enforceConversationLimit(Shard &shard);
+    void expireConversations(Shard &shard, qint64 nowSecs);
+    void removeConversation(Shard &shard, quint32 slot);
 
     // Data members
-    mutable QMutex m_mutex;
-    QHash<QString, Conversation> m_conversations;     // Key: conversation ID
-    QHash<QString, quint32> m_tcpStreamMap;          // Key: conversation ID, Value: stream index
-    QHash<quint32, TcpStream> m_tcpStreams;          // Key: stream index
-    
-    quint32 m_nextStreamIndex;
-    quint64 m_maxConversations;
-    int m_conversationTimeout;                        // Seconds
-    bool m_enableStreamReassembly;
-    quint64 m_maxStreamSize;                          // Maximum stream size in bytes
-    
-    // Statistics cache
-    quint64 m_totalPackets;
-    quint64 m_totalBytes;
+    SymbolTable m_protocolNames;                      // FlowKey::protocol IDs, one per tracker
+    QList<std::shared_ptr<Shard>> m_shards;
+    
+    // Settings are read by every shard's ingest without a common lock, so
+    // they may be changed while ingest runs
+    std::atomic<quint64> m_maxConversations;
+    std::atomic<int> m_conversationTimeout;           // Seconds
+    std::atomic<bool> m_enableStreamReassembly;
+    std::atomic<quint64> m_maxStreamSize;             // Maximum stream size in bytes
+    std::atomic<bool> m_lockFreeIngest;               // Shards owned by single threads
+    quint16 m_tcpProtocolId;
+
+    // Notification coalescing
+    QTimer *m_notifyTimer;
+    std::atomic<int> m_notifyIntervalMs;              // 0 = emit per packet
 };
 
 #endif // CONVERSATIONTRACKER_H
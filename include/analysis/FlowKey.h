@@ -0,0 +1,113 @@
+#ifndef FLOWKEY_H
+#define FLOWKEY_H
+
+#include <QtGlobal>
+#include <QString>
+#include <cstring>
+
+/**
+ * @brief One side of a flow: a 128-bit address and a port
+ *
+ * IPv4 addresses are stored as IPv4-mapped IPv6 (::ffff:a.b.c.d) so both
+ * families share one layout and compare numerically.
+ */
+struct FlowEndpoint {
+    quint64 addr[2];                 // Address, big-endian word order
+    quint16 port;
+
+    FlowEndpoint() : addr{0, 0}, port(0) {}
+
+    bool operator<(const FlowEndpoint &other) const {
+        if (addr[0] != other.addr[0]) return addr[0] < other.addr[0];
+        if (addr[1] != other.addr[1]) return addr[1] < other.addr[1];
+        return port < other.port;
+    }
+};
+
+/**
+ * @brief Packed, fixed-size binary 5-tuple identifying a conversation
+ *
+ * The two endpoints are stored in canonical (numerically sorted) order so
+ * A->B and B->A packets produce the same key. The direction of a given
+ * packet relative to that order is returned separately by fromAddresses().
+ */
+struct FlowKey {
+    enum Flags : quint8 {
+        HashedAddresses = 0x01       // Non-IP addresses, stored as a 128-bit hash
+    };
+
+    quint64 lowAddr[2];              // Canonically lower endpoint address
+    quint64 highAddr[2];             // Canonically higher endpoint address
+    quint16 lowPort;
+    quint16 highPort;
+    quint16 protocol;                // Protocol ID in the tracker's SymbolTable
+    quint8 flags;
+    quint8 reserved;
+
+    FlowKey() : lowAddr{0, 0}, highAddr{0, 0}, lowPort(0), highPort(0),
+                protocol(0), flags(0), reserved(0) {}
+
+    /**
+     * @brief Build a canonical key from textual endpoints
+     * @param reversed Set to true when the source endpoint is the high side
+     */
+    static FlowKey fromAddresses(quint16 protocol,
+                                 const QString &srcAddr, quint16 srcPort,
+                                 const QString &dstAddr, quint16 dstPort,
+                                 bool *reversed = nullptr);
+
+    /**
+     * @brief Encode a textual address into a FlowEndpoint
+     * @return false if the address is not IPv4/IPv6 and had to be hashed
+     */
+    static bool encodeAddress(const QString &address, FlowEndpoint &endpoint);
+
+    /**
+     * @brief 64-bit hash over the endpoints only (protocol excluded)
+     *
+     * Symmetric by construction, since the key itself is canonical. Used to
+     * route flows to shards before the protocol id is resolved.
+     */
+    quint64 endpointHash() const {
+        quint64 tail = (static_cast<quint64>(lowPort) << 48) |
+                       (static_cast<quint64>(highPort) << 32) |
+                       (static_cast<quint64>(flags) << 8);
+        quint64 h = mix(0x94D049BB133111EBULL, lowAddr[0]);
+        h = mix(h, lowAddr[1]);
+        h = mix(h, highAddr[0]);
+        h = mix(h, highAddr[1]);
+        h = mix(h, tail);
+        return h ^ (h >> 29);
+    }
+
+    /**
+     * @brief 64-bit hash over the full packed key
+     */
+    quint64 hash() const {
+        quint64 h = mix(endpointHash(), protocol);
+        return h ^ (h >> 29);
+    }
+
+    bool operator==(const FlowKey &other) const {
+        return std::memcmp(this, &other, sizeof(FlowKey)) == 0;
+    }
+    bool operator!=(const FlowKey &other) const {
+        return !(*this == other);
+    }
+
+private:
+    static quint64 mix(quint64 h, quint64 v) {
+        h ^= v * 0x9E3779B97F4A7C15ULL;
+        h = (h << 31) | (h >> 33);
+        return h * 0xBF58476D1CE4E5B9ULL;
+    }
+};
+
+static_assert(sizeof(FlowKey) == 40, "FlowKey must stay packed");
+
+inline uint qHash(const FlowKey &key, uint seed = 0) noexcept {
+    quint64 h = key.hash();
+    return static_cast<uint>(h ^ (h >> 32)) ^ seed;
+}
+
+#endif // FLOWKEY_H
@@ -0,0 +1,63 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Log-linear (HDR-style) histogram of non-negative integers
+ *
+ * Values below 2^precision get a bucket each and are counted exactly;
+ * above that every power-of-two range is split into 2^(precision - 1)
+ * equal buckets, so a value is known to within 2^-(precision - 1) of
+ * itself. The bucket index is computed from the position of the highest
+ * set bit, without a search.
+ *
+ * Counts are allocated up to the highest bucket used and are implicitly
+ * shared. Histograms of equal precision merge by adding counts.
+ */
+class Histogram {
+public:
+    explicit Histogram(int precision = 10);
+
+    void record(quint64 value, quint64 count = 1);
+    void merge(const Histogram &other);
+    void clear();
+
+    bool isEmpty() const { return m_total == 0; }
+    quint64 totalCount() const { return m_total; }
+    quint64 min() const { return m_total ? m_min : 0; }
+    quint64 max() const { return m_max; }
+    double mean() const { return m_total ? static_cast<double>(m_sum) / m_total : 0.0; }
+    int precision() const { return m_precision; }
+
+    /**
+     * @brief Nearest-rank percentile, exact to the bucket width and clamped
+     * to the recorded minimum and maximum
+     */
+    quint64 valueAtPercentile(double percentile) const;
+
+    // Values whose bucket starts in [low, high)
+    quint64 countBetween(quint64 low, quint64 high) const;
+
+    template <typename Fn>
+    void forEachBucket(Fn fn) const {                // fn(lowest, highest, count)
+        for (int i = 0; i < m_counts.size(); ++i) {
+            if (m_counts.at(i)) fn(lowestValue(i), highestValue(i), m_counts.at(i));
+        }
+    }
+
+private:
+    int bucketIndex(quint64 value) const;
+    quint64 lowestValue(int index) const;
+    quint64 highestValue(int index) const;
+
+    int m_precision;                 // Bits counted exactly
+    QVector<quint64> m_counts;       // Index: bucketIndex()
+    quint64 m_total;
+    quint64 m_sum;
+    quint64 m_min;
+    quint64 m_max;
+};
+
+#endif // HISTOGRAM_H
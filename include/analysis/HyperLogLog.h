@@ -0,0 +1,54 @@
+#ifndef HYPERLOGLOG_H
+#define HYPERLOGLOG_H
+
+#include <QVector>
+#include <QtGlobal>
+
+/**
+ * @brief Fixed-size distinct-count sketch (HyperLogLog)
+ *
+ * Items are added as 64-bit hashes; the top precision bits pick one of
+ * 2^precision one-byte registers, which keeps the longest run of leading
+ * zeros seen in the remaining bits. The standard error of estimate() is
+ * about 1.04 / sqrt(2^precision) at any cardinality, and small counts are
+ * corrected by linear counting. Memory does not grow with the number of
+ * items.
+ *
+ * Small sets, which is most per-endpoint sketches, keep their distinct
+ * hashes in a sorted array and are counted exactly; once that array would
+ * be as large as the registers it is converted to them.
+ *
+ * Sketches of equal precision merge by uniting their hashes or taking the
+ * register maxima, so the union of several streams costs no more than one.
+ */
+class HyperLogLog {
+public:
+    enum { DefaultPrecision = 12 };
+
+    explicit HyperLogLog(int precision = DefaultPrecision);
+
+    // Well-mixed 64-bit hash of an integer key (SplitMix64 finalizer)
+    static quint64 hash(quint64 key);
+
+    void add(quint64 hash);
+    void addKey(quint64 key) { add(hash(key)); }
+    void merge(const HyperLogLog &other);
+    void clear();
+
+    bool isEmpty() const { return m_sparse.isEmpty() && m_registers.isEmpty(); }
+    int precision() const { return m_precision; }
+    double relativeError() const;
+    quint64 estimate() const;
+
+private:
+    bool isDense() const { return !m_registers.isEmpty(); }
+    int maxSparse() const { return (1 << m_precision) / 8; }
+    void addToRegisters(quint64 hash);
+    void convertToRegisters();
+
+    int m_precision;
+    QVector<quint64> m_sparse;       // Sorted distinct hashes while sparse
+    QVector<quint8> m_registers;     // Index: top precision bits of the hash
+};
+
+#endif // HYPERLOGLOG_H
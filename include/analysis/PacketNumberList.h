@@ -0,0 +1,78 @@
+#ifndef PACKETNUMBERLIST_H
+#define PACKETNUMBERLIST_H
+
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief Append-only compressed list of packet numbers
+ *
+ * Numbers are stored as zig-zag varint deltas from their predecessor, so a
+ * mostly increasing sequence costs one or two bytes per entry instead of
+ * eight. Every BlockSize entries a block header records the absolute value
+ * and byte offset, which bounds random access to decoding one block.
+ *
+ * Storage is implicitly shared; copying a list is cheap.
+ */
+class PacketNumberList {
+public:
+    enum { BlockSize = 128 };
+
+    class const_iterator {
+    public:
+        quint64 operator*() const { return m_value; }
+        const_iterator &operator++();
+        bool operator==(const const_iterator &other) const { return m_index == other.m_index; }
+        bool operator!=(const const_iterator &other) const { return m_index != other.m_index; }
+
+    private:
+        friend class PacketNumberList;
+        const_iterator(const PacketNumberList *list, int index);
+
+        const PacketNumberList *m_list;
+        int m_index;
+        int m_pos;                   // Byte offset of the next delta
+        quint64 m_value;
+    };
+
+    PacketNumberList() : m_size(0), m_last(0) {}
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    quint64 last() const { return m_last; }
+
+    void append(quint64 number);
+    quint64 at(int index) const;
+    QList<quint64> mid(int index, int count = -1) const;
+    QList<quint64> toList() const { return mid(0); }
+
+    const_iterator begin() const { return const_iterator(this, 0); }
+    const_iterator end() const { return const_iterator(this, m_size); }
+
+    /**
+     * @brief Bytes used by the encoding (excluding container growth slack)
+     */
+    int encodedSize() const;
+
+    void squeeze();
+    void clear();
+
+private:
+    struct Block {
+        quint64 first;               // Absolute value of the block's first entry
+        int offset;                  // Byte offset of its second entry's delta
+
+        Block() : first(0), offset(0) {}
+        Block(quint64 f, int o) : first(f), offset(o) {}
+    };
+
+    quint64 decodeNext(int *pos, quint64 previous) const;
+
+    QByteArray m_deltas;
+    QVector<Block> m_blocks;
+    int m_size;
+    quint64 m_last;
+};
+
+#endif // PACKETNUMBERLIST_H
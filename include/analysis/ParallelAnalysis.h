@@ -0,0 +1,80 @@
+#ifndef PARALLELANALYSIS_H
+#define PARALLELANALYSIS_H
+
+#include <QFuture>
+#include <QList>
+#include <QThread>
+#include <QThreadPool>
+#include <QVector>
+#include <functional>
+#include <memory>
+#include "../models/PacketModel.h"
+
+class ConversationTracker;
+class StatisticsEngine;
+
+/**
+ * @brief Offline analysis of one capture split across worker threads
+ *
+ * Each worker owns a private StatisticsEngine and ConversationTracker, so
+ * workers never share a lock. Batches are partitioned either by flow (a
+ * symmetric endpoint hash, so every conversation stays on one worker) or by
+ * time (whole batches dealt round-robin, so a conversation may be seen by
+ * several workers). mergeInto() waits for the workers and folds their
+ * state into the caller's engines; flows split by time are stitched there.
+ * TCP analysis state does not cross workers, so with time partitioning a
+ * retransmission, RTT sample or duplicate ACK straddling two batches on
+ * different workers is missed.
+ *
+ * addPackets() must be called from one thread. A worker runs at most one
+ * batch at a time, which keeps its packets in capture order.
+ */
+class ParallelAnalysis {
+public:
+    enum Partitioning {
+        ByFlow,                      // Conversations never span workers
+        ByTime                       // Consecutive batches go to different workers
+    };
+
+    // Applied to each worker's engines when they are created
+    typedef std::function<void(StatisticsEngine *, ConversationTracker *)> Configurator;
+
+    explicit ParallelAnalysis(int workers = QThread::idealThreadCount(),
+                              Partitioning partitioning = ByFlow);
+    ~ParallelAnalysis();
+
+    void setConfigurator(const Configurator &configure);   // Before the first addPackets()
+
+    int workerCount() const { return m_workerCount; }
+    Partitioning partitioning() const { return m_partitioning; }
+
+    // timestampsUs as for StatisticsEngine::addPackets()
+    void addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                    const QVector<qint64> &timestampsUs = QVector<qint64>());
+    void waitForFinished();
+
+    /**
+     * @brief Merge every worker's results into the given engines
+     *
+     * Either pointer may be null. Workers keep their state, so the same
+     * results can be merged into several targets; clear() drops it.
+     */
+    void mergeInto(StatisticsEngine *statistics, ConversationTracker *tracker);
+    void clear();
+
+private:
+    struct Worker;
+
+    void createWorkers();
+    void submit(Worker &worker, const QList<std::shared_ptr<PacketModel>> &packets,
+                const QVector<qint64> &timestampsUs);
+
+    int m_workerCount;
+    Partitioning m_partitioning;
+    Configurator m_configure;
+    QThreadPool m_pool;
+    QVector<std::shared_ptr<Worker>> m_workers;  // Created on the first batch
+    int m_nextWorker;                            // Round-robin position for ByTime
+};
+
+#endif // PARALLELANALYSIS_H
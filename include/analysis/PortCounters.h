@@ -0,0 +1,55 @@
+#ifndef PORTCOUNTERS_H
+#define PORTCOUNTERS_H
+
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+/**
+ * @brief Flat per-port packet counters covering the whole 16-bit port space
+ *
+ * One 512 KB array indexed by port replaces hashing on the ingest path. The
+ * array is allocated on the first increment so idle instances (such as
+ * empty per-thread accumulators) stay small.
+ */
+class PortCounters {
+public:
+    enum { PortCount = 65536 };
+
+    void increment(quint16 port) { add(port, 1); }
+
+    void add(quint16 port, quint64 count) {
+        if (m_counts.isEmpty()) m_counts.fill(0, PortCount);
+        m_counts[port] += count;
+    }
+
+    quint64 count(quint16 port) const { return m_counts.isEmpty() ? 0 : m_counts.at(port); }
+    bool isEmpty() const { return m_counts.isEmpty(); }
+
+    /**
+     * @brief The @p k ports with the highest counts, descending
+     *
+     * Blocks whose maximum does not beat the current k-th count are skipped
+     * without touching the heap; the block maximum is a branch-free
+     * reduction the compiler vectorises.
+     */
+    QList<QPair<quint16, quint64>> top(int k) const;
+
+    void merge(const PortCounters &other);
+    void swap(PortCounters &other) { m_counts.swap(other.m_counts); }
+    void clear() { m_counts.clear(); }
+
+    template <typename Fn>
+    void forEachNonZero(Fn fn) const {
+        if (m_counts.isEmpty()) return;
+        const quint64 *counts = m_counts.constData();
+        for (int port = 0; port < PortCount; ++port) {
+            if (counts[port]) fn(static_cast<quint16>(port), counts[port]);
+        }
+    }
+
+private:
+    QVector<quint64> m_counts;                   // Empty until first use
+};
+
+#endif // PORTCOUNTERS_H
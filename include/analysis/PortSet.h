@@ -0,0 +1,41 @@
+#ifndef PORTSET_H
+#define PORTSET_H
+
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief Compact set of 16-bit ports
+ *
+ * Small sets, which is most endpoints, are a sorted array of ports. Once a
+ * set outgrows MaxSparse entries it switches to an 8 KB bitset covering the
+ * whole port space, so scanners and busy servers cost a fixed amount.
+ */
+class PortSet {
+public:
+    PortSet() : m_size(0) {}
+
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+
+    bool contains(quint16 port) const;
+    bool insert(quint16 port);                   // Returns true if the port was added
+    void unite(const PortSet &other);
+    QList<quint16> values() const;               // Ascending order
+    void clear();
+
+private:
+    enum {
+        MaxSparse = 64,                          // 128 bytes before switching to the bitset
+        BitsetWords = 65536 / 64
+    };
+
+    bool isDense() const { return !m_bits.isEmpty(); }
+    void convertToBitset();
+
+    QVector<quint16> m_sparse;                   // Sorted ports while sparse
+    QVector<quint64> m_bits;                     // One bit per port while dense
+    int m_size;
+};
+
+#endif // PORTSET_H
@@ -0,0 +1,77 @@
+#ifndef PROTOCOLCLASSIFIER_H
+#define PROTOCOLCLASSIFIER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Application protocol detection from the first payload bytes of a flow
+ *
+ * Signatures are byte patterns, optionally pinned to an offset, compiled
+ * into one Aho-Corasick automaton stored as a dense transition table, so
+ * classifying a payload is a single pass over at most ScanLength bytes
+ * whatever the number of signatures. A pattern hit can be confirmed or
+ * enriched by a structural check (HTTP Host, TLS SNI, QUIC long header).
+ * DNS has no fixed bytes and is recognised from its header shape when no
+ * pattern matches a UDP payload.
+ *
+ * A compiled classifier is immutable and safe to share between threads.
+ */
+class ProtocolClassifier {
+public:
+    enum { ScanLength = 64 };        // Bytes of each payload fed to the automaton
+
+    enum Check {
+        NoCheck,
+        HttpRequest,                 // Request line; yields the Host header
+        TlsRecord,                   // Handshake record; ClientHello yields the SNI
+        QuicLongHeader               // Long header form bit set
+    };
+
+    enum Transport {
+        AnyTransport,
+        TcpOnly,
+        UdpOnly
+    };
+
+    struct Match {
+        QString protocol;            // Empty if nothing matched
+        QString serverName;          // TLS SNI or HTTP Host, when present
+
+        bool isValid() const { return !protocol.isEmpty(); }
+    };
+
+    /**
+     * @brief The built-in signature set, compiled once
+     */
+    static const ProtocolClassifier &standard();
+
+    ProtocolClassifier();
+
+    // Signatures added first win when several match. Offset -1 matches anywhere
+    void addSignature(const QString &protocol, const QByteArray &pattern, int offset = 0,
+                      Transport transport = AnyTransport, Check check = NoCheck);
+    void compile();
+
+    Match classify(const uchar *data, int length, bool udp) const;
+
+private:
+    struct Signature {
+        QString protocol;
+        QByteArray pattern;
+        int offset;
+        Transport transport;
+        Check check;
+    };
+
+    bool accepts(const Signature &signature, const uchar *data, int length, bool udp,
+                 Match *match) const;
+
+    QVector<Signature> m_signatures;
+    QVector<quint16> m_transitions;              // Index: state * 256 + byte
+    QVector<QVector<quint16>> m_outputs;         // Index: state; signature indices, ascending
+    bool m_compiled;
+};
+
+#endif // PROTOCOLCLASSIFIER_H
@@ -0,0 +1,94 @@
+#ifndef RATESERIES_H
+#define RATESERIES_H
+
+#include <QVector>
+
+/**
+ * @brief Bounded multi-resolution packet/byte counts over time
+ *
+ * Counts are kept at 1 ms, 1 s, 1 min and 1 h resolution, each level in a
+ * fixed ring of buckets, so memory does not grow with capture length; older
+ * data survives only at the coarser levels. Each bucket holds the running
+ * total up to its end, so any aligned range sums in O(1) and resample()
+ * costs O(points returned). Buckets nobody wrote read as empty, which
+ * zero-fills idle gaps.
+ *
+ * Adds are O(1) when time moves forward. A late add pays for the buckets
+ * between it and the newest one; an add older than a level's window is
+ * folded in before that window.
+ *
+ * Rings are allocated on the first add.
+ */
+class RateSeries {
+public:
+    enum Resolution { Millisecond, Second, Minute, Hour, ResolutionCount };
+
+    enum Retention {
+        Full,                    // 10 s of 1 ms buckets
+        Compact                  // 1 s of 1 ms buckets, for per-protocol series
+    };
+
+    struct Sample {
+        qint64 startMs;
+        quint64 packets;
+        quint64 bytes;
+
+        Sample() : startMs(0), packets(0), bytes(0) {}
+    };
+
+    explicit RateSeries(Retention retention = Full);
+
+    void add(qint64 ms, quint64 packets, quint64 bytes);
+    bool isEmpty() const { return m_levels[Millisecond].buckets.isEmpty(); }
+    void clear();
+
+    /**
+     * @brief Add every count of @p other, level by level
+     *
+     * Each merged level keeps the window ending at the newer of the two
+     * heads; counts of @p other older than that window are folded in before
+     * it, as a late add() would. O(capacity) per level.
+     */
+    void merge(const RateSeries &other);
+
+    /**
+     * @brief Counts per @p intervalMs over [fromMs, toMs)
+     *
+     * Intervals are aligned to multiples of @p intervalMs. They are summed
+     * from the coarsest level whose resolution divides the interval and
+     * whose window reaches back to @p fromMs; if none does, the range is
+     * clipped to the longest window available for that interval.
+     */
+    QVector<Sample> resample(qint64 fromMs, qint64 toMs, int intervalMs) const;
+
+private:
+    struct Totals {
+        quint64 packets;
+        quint64 bytes;
+
+        Totals() : packets(0), bytes(0) {}
+    };
+
+    struct Level {
+        qint64 resolutionMs;
+        int capacity;
+        QVector<Totals> buckets; // Running totals; bucket b lives at b mod capacity
+        qint64 head;             // Newest bucket
+        Totals base;             // Running total before the oldest bucket
+
+        Level() : resolutionMs(1), capacity(1), head(0) {}
+
+        qint64 oldest() const { return head - capacity + 1; }
+        int index(qint64 bucket) const;
+        Totals total(qint64 bucket) const;  // Running total through bucket
+        void add(qint64 bucket, quint64 packets, quint64 bytes);
+        void advance(qint64 bucket);
+        void merge(const Level &other);
+    };
+
+    const Level *levelFor(qint64 fromMs, int intervalMs) const;
+
+    Level m_levels[ResolutionCount];
+};
+
+#endif // RATESERIES_H
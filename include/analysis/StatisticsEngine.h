@@ -4,10 +4,25 @@
 #include <QObject>
 #include <QHash>
 #include <QList>
+#include <QVector>
 #include <QDateTime>
 #include <QMutex>
+#include <atomic>
+#include <functional>
 #include <memory>
 #include "../models/PacketModel.h"
+#include "AnomalyDetector.h"
+#include "Histogram.h"
+#include "HyperLogLog.h"
+#include "PortCounters.h"
+#include "PortSet.h"
+#include "RateSeries.h"
+#include "Timestamp.h"
+#include "StreamSummary.h"
+#include "SymbolTable.h"
+
+class QThread;
+class QTimer;
 
 /**
  * @brief Protocol distribution statistics
@@ -21,12 +36,16 @@ struct ProtocolStats {
     double avgPacketSize;        // Average packet size
     quint64 minPacketSize;
     quint64 maxPacketSize;
-    QDateTime firstSeen;
-    QDateTime lastSeen;
+    qint64 firstSeenUs;          // Microseconds since epoch
+    qint64 lastSeenUs;
 
     ProtocolStats() : packetCount(0), byteCount(0), percentage(0.0),
                      bytesPercentage(0.0), avgPacketSize(0.0),
-                     minPacketSize(0), maxPacketSize(0) {}
+                     minPacketSize(0), maxPacketSize(0),
+                     firstSeenUs(InvalidTimestamp), lastSeenUs(InvalidTimestamp) {}
+
+    QDateTime firstSeen() const { return dateTimeFromUs(firstSeenUs); }
+    QDateTime lastSeen() const { return dateTimeFromUs(lastSeenUs); }
 };
 
 /**
@@ -41,27 +60,36 @@ struct EndpointStats {
     quint64 totalPackets;
     quint64 totalBytes;
     QSet<QString> protocols;     // Protocols used
-    QSet<quint16> portsSrc;      // Source ports used
-    QSet<quint16> portsDst;      // Destination ports contacted
-    QDateTime firstSeen;
-    QDateTime lastSeen;
+    PortSet portsSrc;            // Source ports used
+    PortSet portsDst;            // Destination ports contacted
+    quint64 distinctPeers;       // Estimated addresses exchanged packets with
+    quint64 distinctPortsContacted; // Estimated destination ports sent to
+    qint64 firstSeenUs;          // Microseconds since epoch
+    qint64 lastSeenUs;
 
     EndpointStats() : packetsSent(0), packetsReceived(0), bytesSent(0),
-                     bytesReceived(0), totalPackets(0), totalBytes(0) {}
+                     bytesReceived(0), totalPackets(0), totalBytes(0),
+                     distinctPeers(0), distinctPortsContacted(0),
+                     firstSeenUs(InvalidTimestamp), lastSeenUs(InvalidTimestamp) {}
+
+    QDateTime firstSeen() const { return dateTimeFromUs(firstSeenUs); }
+    QDateTime lastSeen() const { return dateTimeFromUs(lastSeenUs); }
 };
 
 /**
  * @brief Time-series data point for packet rate analysis
  */
 struct PacketRatePoint {
-    QDateTime timestamp;
+    qint64 timestampUs;          // Interval start, microseconds since epoch
     quint64 packetCount;
     quint64 byteCount;
     double packetsPerSecond;
     double bitsPerSecond;
 
-    PacketRatePoint() : packetCount(0), byteCount(0),
+    PacketRatePoint() : timestampUs(InvalidTimestamp), packetCount(0), byteCount(0),
                        packetsPerSecond(0.0), bitsPerSecond(0.0) {}
+
+    QDateTime timestamp() const { return dateTimeFromUs(timestampUs); }
 };
 
 /**
@@ -76,6 +104,43 @@ struct PacketSizeBucket {
     PacketSizeBucket() : minSize(0), maxSize(0), count(0), percentage(0.0) {}
 };
 
+/**
+ * @brief Percentiles of a recorded distribution
+ */
+struct PercentileSummary {
+    quint64 count;
+    quint64 min;
+    quint64 max;
+    double mean;
+    quint64 p50;
+    quint64 p90;
+    quint64 p99;
+    quint64 p999;
+
+    PercentileSummary() : count(0), min(0), max(0), mean(0.0), p50(0), p90(0), p99(0),
+                          p999(0) {}
+};
+
+/**
+ * @brief Estimated distinct counts over one scope of traffic
+ */
+struct CardinalityEstimate {
+    quint64 sources;             // Source addresses
+    quint64 destinations;        // Destination addresses
+    quint64 sourcePorts;
+    quint64 destinationPorts;
+    quint64 flows;               // Address and port pairs, either direction
+    double relativeError;        // Standard error of each count
+
+    CardinalityEstimate() : sources(0), destinations(0), sourcePorts(0), destinationPorts(0),
+                            flows(0), relativeError(0.0) {}
+};
+
+struct CardinalityEstimates {
+    CardinalityEstimate overall;
+    QHash<QString, CardinalityEstimate> byProtocol;
+};
+
 /**
  * @brief Overall capture statistics
  */
@@ -89,8 +154,8 @@ struct CaptureStatistics {
     quint64 droppedPackets;
 
     // Timing
-    QDateTime captureStart;
-    QDateTime captureEnd;
+    qint64 captureStartUs;       // Microseconds since epoch
+    qint64 captureEndUs;
     double captureDuration;      // Seconds
     
     // Rates
@@ -107,10 +172,14 @@ struct CaptureStatistics {
 
     CaptureStatistics() : totalPackets(0), totalBytes(0), displayedPackets(0),
                          displayedBytes(0), markedPackets(0), droppedPackets(0),
+                         captureStartUs(InvalidTimestamp), captureEndUs(InvalidTimestamp),
                          captureDuration(0.0), avgPacketsPerSecond(0.0),
                          avgBitsPerSecond(0.0), avgMbitsPerSecond(0.0),
                          peakPacketsPerSecond(0.0), peakBitsPerSecond(0.0),
                          avgPacketSize(0.0), minPacketSize(0), maxPacketSize(0) {}
+
+    QDateTime captureStart() const { return dateTimeFromUs(captureStartUs); }
+    QDateTime captureEnd() const { return dateTimeFromUs(captureEndUs); }
 };
 
 /**
@@ -125,9 +194,23 @@ public:
 
     // Packet processing
     void addPacket(const std::shared_ptr<PacketModel> &packet);
+    // One lock and one set of signals per batch. timestampsUs is empty or holds
+    // each packet's capture time in microseconds, finer than PacketModel::timestamp
+    void addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                    const QVector<qint64> &timestampsUs = QVector<qint64>());
     void clear();
     void reset();
 
+    /**
+     * @brief Fold the state of another engine into this one
+     *
+     * Used to combine partitions of one capture analysed by separate
+     * engines. Counters add, time bounds widen, endpoints and rate series
+     * combine and peaks are re-read from the merged series. An engine with
+     * per-thread accumulation must be flushed before it is merged from.
+     */
+    void merge(const StatisticsEngine &other);
+
     // Overall statistics
     CaptureStatistics getCaptureStatistics() const;
     void updateDisplayFilter(quint64 displayedPackets, quint64 displayedBytes);
@@ -135,7 +218,7 @@ public:
     void setDroppedPackets(quint64 count);
 
     // Protocol statistics
-    QList<ProtocolStats> getProtocolStatistics() const;
+    QList<ProtocolStats> getProtocolStatistics() const;  // Shared snapshot, copied only on write
     ProtocolStats getProtocolStats(const QString &protocol) const;
     QHash<QString, quint64> getProtocolDistribution() const; // Protocol -> packet count
     QList<QString> getTopProtocols(int count) const;
@@ -145,15 +228,34 @@ public:
     EndpointStats getEndpointStats(const QString &address) const;
     QList<EndpointStats> getTopEndpointsByPackets(int count) const;
     QList<EndpointStats> getTopEndpointsByBytes(int count) const;
+    // Visits every endpoint under the lock without building a list; return
+    // false to stop. The visitor must not call back into the engine
+    void visitEndpointStatistics(const std::function<bool(const EndpointStats &)> &visitor) const;
 
-    // Time-series analysis
+    // Time-series analysis: completed intervals, resampled from the rate store.
+    // Intervals finer than 1 s reach back 10 s (1 s per protocol), finer than
+    // 1 min reach back 1 h, and so on up to 30 days of hourly points
     QList<PacketRatePoint> getPacketRateTimeSeries(int intervalMs = 1000) const;
     QList<PacketRatePoint> getPacketRateForProtocol(const QString &protocol, int intervalMs = 1000) const;
     QPair<double, double> getPeakRate() const; // (packets/sec, bits/sec)
 
-    // Packet size analysis
+    // Packet size analysis. Sizes are kept in log-linear histograms, exact
+    // below 2048 bytes; the bucket lists are views over them, so changing
+    // the boundaries also re-buckets packets already seen
     QList<PacketSizeBucket> getPacketSizeDistribution() const;
     QList<PacketSizeBucket> getPacketSizeDistributionForProtocol(const QString &protocol) const;
+    PercentileSummary getPacketSizePercentiles() const;
+    PercentileSummary getPacketSizePercentilesForProtocol(const QString &protocol) const;
+
+    // Gaps between consecutive packets in microseconds, exact below 256 us and
+    // within 1% above. Measured per ingest stream: merged engines and per-thread accumulators
+    // combine the gaps each stream saw
+    PercentileSummary getInterArrivalPercentiles() const;
+    PercentileSummary getInterArrivalPercentilesForProtocol(const QString &protocol) const;
+
+    // Distinct counts from fixed-size sketches, so unlike the endpoint and
+    // conversation tables they are not capped and see through eviction
+    CardinalityEstimates getCardinalityEstimates() const;
 
     // Port analysis
     QHash<quint16, quint64> getTopSourcePorts(int count) const;
@@ -165,38 +267,156 @@ public:
     QHash<QString, quint64> getErrorsByType() const;
     QList<std::shared_ptr<PacketModel>> getErrorPackets() const;
 
-    // Export
+    // Export. Each export copies a consistent snapshot under the lock (the
+    // containers are implicitly shared, so this is O(1) per table) and
+    // formats it afterwards, one record at a time, without holding the lock.
+    // Full exports replace their file atomically. With per-thread
+    // accumulation, packets not yet merged are merged first
     bool exportStatisticsToJson(const QString &filePath) const;
     bool exportStatisticsToCsv(const QString &filePath) const;
+    /**
+     * @brief Export as compact columnar tables
+     *
+     * QDataStream, big-endian: "GSTB" magic (quint32), layout version
+     * (quint16) and table count (quint16); then per table its name, row
+     * count (quint32) and column count (quint16); then per column its name,
+     * type (quint8: 0 quint64, 1 qint64, 2 double, 3 QString) and all row
+     * values back to back. The tables are capture, protocols, endpoints,
+     * rates and ports; unknown timestamps are INT64_MIN.
+     */
+    bool exportStatisticsToBinary(const QString &filePath) const;
+    // Appends one NDJSON line of summary metrics: capture totals, the last
+    // completed interval, protocols, distinct counts, errors and the top
+    // endpoints by bytes
+    bool appendStatisticsToNdjson(const QString &filePath) const;
+    // Rolling export: appendStatisticsToNdjson() every intervalSecs seconds
+    // from this object's thread, until stopped or restarted
+    void startRollingExport(const QString &filePath, int intervalSecs);
+    void stopRollingExport();
     QString getStatisticsSummary() const;
 
     // Configuration
     void setTimeSeriesInterval(int intervalMs);
     void setPacketSizeBuckets(const QList<quint64> &boundaries);
     void setMaxEndpoints(int max);
+    // With a non-zero interval, signals are no longer emitted per packet but
+    // at most once per interval from this object's thread
+    void setNotificationInterval(int intervalMs);
+    // Per-thread accumulation: ingest threads update private accumulators that
+    // are merged on the notification timer (or every 100 ms) and by
+    // flushAccumulators(). Capture, protocol, size and rate getters then read
+    // an atomically published snapshot and never wait for writers. It may be
+    // switched while other threads are ingesting; no packet is lost
+    void setPerThreadAccumulation(bool enable);
+    void flushAccumulators();
+    // Anomaly detection scores each completed time-series interval and
+    // raises anomalyDetected(); on by default. It runs on the locking ingest
+    // path only, not on per-thread accumulators
+    void setAnomalyDetection(bool enable);
+    void setAnomalySettings(const AnomalyDetector::Settings &settings);
 
 signals:
     void statisticsUpdated();
     void protocolStatsUpdated();
     void endpointStatsUpdated();
     void rateUpdated(double packetsPerSecond, double bitsPerSecond);
+    void anomalyDetected(const AnomalyAlert &alert);
 
 private:
-    // Protocol tracking
-    void updateProtocolStats(const std::shared_ptr<PacketModel> &packet);
-    void recalculateProtocolPercentages();
+    // Packet processing (caller holds m_mutex)
+    bool processPacket(const std::shared_ptr<PacketModel> &packet, qint64 packetUs);
+    void updateDerivedStatistics();
+
+    // Notification coalescing
+    void queueNotifications(bool rateChanged);
+    void publishPendingUpdates();
 
-    // Endpoint tracking
-    void updateEndpointStats(const std::shared_ptr<PacketModel> &packet);
+    // Export
+    struct ExportSnapshot;
+    ExportSnapshot exportSnapshot(bool withEndpoints) const;
+    void writeRollingExport();
+
+    // Per-thread accumulation
+    struct Accumulator;
+    struct Snapshot;
+    Accumulator &localAccumulator();
+    void mergeAccumulators();
+    bool foldAccumulator(const Accumulator &batch);  // Caller holds m_mutex
+    void publishSnapshot();                           // Caller holds m_mutex
+
+    // Protocol tracking
+    void updateProtocolStats(const std::shared_ptr<PacketModel> &packet, quint32 protocolId,
+                             qint64 timeUs);
+    void finalizeProtocolStats(ProtocolStats &stats) const;
+
+    // Read-side snapshots, rebuilt only when m_generation has moved
+    const QList<ProtocolStats> &protocolSnapshot() const;
+    const QList<PacketSizeBucket> &sizeDistributionSnapshot() const;
+
+    // Endpoint tracking; state is keyed by IDs from the engine's symbol tables
+    // and the address and protocol names are filled in only when an
+    // EndpointStats is handed out. Each record's address is held by
+    // m_addressIds until the record is evicted
+    struct EndpointRecord {
+        EndpointStats stats;
+        QSet<quint32> protocolIds;
+        HyperLogLog peers;                        // Address keys
+        HyperLogLog portsContacted;               // Destination ports sent to
+
+        // Anomaly detection: baselines and counts of the open interval
+        AnomalyDetector::Baseline packetBaseline;
+        AnomalyDetector::Baseline scanBaseline;   // New destination ports per interval
+        quint64 portsAtIntervalStart;             // portsContacted estimate
+        quint32 intervalPackets;
+        quint32 intervalSyns;                     // SYNs without ACK received
+        quint32 intervalSynAcks;                  // SYN-ACKs sent
+        int activeIndex;                          // Position in m_activeEndpoints, -1 if absent
+
+        EndpointRecord();
+        void merge(const EndpointRecord &other);
+    };
+    void updateEndpointStats(const std::shared_ptr<PacketModel> &packet, quint32 protocolId,
+                             const Symbol &src, const Symbol &dst, qint64 timeUs);
     void enforceEndpointLimit();
+    EndpointStats endpointOutput(const QString &address, const EndpointRecord &record) const;
 
     // Time-series tracking
-    void updateTimeSeries(const std::shared_ptr<PacketModel> &packet);
+    bool updateTimeSeries(const std::shared_ptr<PacketModel> &packet, quint32 protocolId,
+                          qint64 timeUs);
     void calculateRates();
 
-    // Size distribution
-    void updateSizeDistribution(const std::shared_ptr<PacketModel> &packet);
-    int getSizeBucketIndex(quint64 size) const;
+    // Size and inter-arrival distributions
+    void updateDistributions(const std::shared_ptr<PacketModel> &packet, quint32 protocolId,
+                             qint64 timeUs, qint64 previousUs, qint64 protocolPreviousUs);
+
+    // Distinct-count sketches for one scope: overall or one protocol
+    struct CardinalitySketches {
+        HyperLogLog sources;                      // Address keys
+        HyperLogLog destinations;
+        HyperLogLog sourcePorts;
+        HyperLogLog destinationPorts;
+        HyperLogLog flows;                        // Direction-independent flow hashes
+
+        explicit CardinalitySketches(int precision = HyperLogLog::DefaultPrecision);
+        void add(const PacketModel &packet, const Symbol &protocol, const Symbol &src,
+                 const Symbol &dst);
+        void merge(const CardinalitySketches &other);
+        void clear();
+        bool isEmpty() const { return flows.isEmpty(); }  // Every packet adds a flow
+        CardinalityEstimate estimate() const;
+    };
+    CardinalityEstimates cardinalityEstimates(const CardinalitySketches &overall,
+                                              const QVector<CardinalitySketches> &protocols) const;
+    void updateCardinality(const std::shared_ptr<PacketModel> &packet, const Symbol &protocol,
+                           const Symbol &src, const Symbol &dst);
+
+    // Anomaly detection
+    void updateDetectionCounters(const std::shared_ptr<PacketModel> &packet, quint32 protocolId,
+                                 quint32 srcId, quint32 dstId);
+    void detectAnomalies(qint64 intervalStartMs, quint64 intervalPackets, qint64 idleIntervals);
+    void raiseAlert(AnomalyAlert alert, AnomalyAlert::Scope scope, const QString &subject,
+                    qint64 intervalStartMs);
+    void emitAlerts(const QList<AnomalyAlert> &alerts);
 
     // Port tracking
     void updatePortStats(const std::shared_ptr<PacketModel> &packet);
@@ -207,31 +427,59 @@ private:
     // Data members
     mutable QMutex m_mutex;
 
+    // Name interning; the caches are used under m_mutex and hold the names
+    // the engine's state refers to
+    SymbolTable m_protocolNames;
+    SymbolTable m_addressNames;
+    SymbolCache m_protocolIds;
+    SymbolCache m_addressIds;
+
     // Overall statistics
     CaptureStatistics m_captureStats;
-    QDateTime m_lastPacketTime;
+    qint64 m_lastPacketTimeUs;
 
     // Protocol statistics
-    QHash<QString, ProtocolStats> m_protocolStats;
+    QVector<ProtocolStats> m_protocolStats;       // Index: protocol ID, packetCount 0 = unused
 
     // Endpoint statistics
-    QHash<QString, EndpointStats> m_endpointStats;
+    QHash<quint32, EndpointRecord> m_endpointStats; // Key: address ID
+    StreamSummary<quint32> m_endpointRank;        // Endpoints ordered by totalPackets
+    StreamSummary<quint32> m_endpointByteRank;    // Bounded heavy hitters by totalBytes
     int m_maxEndpoints;
 
     // Time-series data
-    QList<PacketRatePoint> m_timeSeriesData;
-    int m_timeSeriesInterval;                    // Milliseconds
-    QDateTime m_currentIntervalStart;
+    RateSeries m_rateSeries;
+    QVector<RateSeries> m_protocolRates;         // Index: protocol ID
+    int m_timeSeriesInterval;                    // Milliseconds; rate signal and peak interval
+    qint64 m_currentIntervalStartMs;             // Aligned to the interval, -1 = none yet
     quint64 m_currentIntervalPackets;
     quint64 m_currentIntervalBytes;
-
-    // Packet size distribution
-    QList<quint64> m_sizeBucketBoundaries;       // Bucket boundaries
-    QList<PacketSizeBucket> m_sizeDistribution;
+    PacketRatePoint m_lastRate;                  // Most recently completed interval
+
+    // Packet size and inter-arrival distributions
+    QList<quint64> m_sizeBucketBoundaries;       // Boundaries of the bucket view
+    Histogram m_sizeHistogram;
+    Histogram m_interArrival;                    // Microseconds
+    QVector<Histogram> m_protocolSizes;          // Index: protocol ID
+    QVector<Histogram> m_protocolInterArrival;   // Index: protocol ID
+
+    // Distinct counts
+    CardinalitySketches m_cardinality;
+    QVector<CardinalitySketches> m_protocolCardinality; // Index: protocol ID
+
+    // Anomaly detection
+    bool m_anomalyDetection;
+    quint32 m_tcpProtocolId;
+    AnomalyDetector m_detector;
+    AnomalyDetector::Baseline m_captureBaseline;
+    QVector<AnomalyDetector::Baseline> m_protocolBaselines; // Index: protocol ID
+    QVector<quint64> m_protocolIntervalPackets;  // Index: protocol ID
+    QVector<quint32> m_activeEndpoints;          // Address IDs seen in the open interval
+    QList<AnomalyAlert> m_pendingAlerts;         // Raised under the lock, emitted outside it
 
     // Port statistics
-    QHash<quint16, quint64> m_srcPortStats;
-    QHash<quint16, quint64> m_dstPortStats;
+    PortCounters m_srcPortStats;                 // Flat port -> packet count arrays
+    PortCounters m_dstPortStats;
 
     // Error tracking
     quint64 m_totalErrors;
@@ -242,6 +490,30 @@ private:
     // Peak tracking
     double m_peakPacketsPerSecond;
     double m_peakBitsPerSecond;
+
+    // Notification coalescing
+    QTimer *m_notifyTimer;
+    int m_notifyIntervalMs;                      // 0 = emit per packet
+    quint32 m_pendingNotifications;              // Signals owed to listeners
+    PacketRatePoint m_pendingRate;
+
+    // Rolling export
+    QTimer *m_rollingTimer;
+    QString m_rollingExportPath;
+
+    // Snapshot invalidation
+    quint64 m_generation;                        // Bumped on every state change
+    mutable QList<ProtocolStats> m_protocolSnapshot;
+    mutable quint64 m_protocolSnapshotGeneration;
+    mutable QList<PacketSizeBucket> m_sizeSnapshot;
+    mutable quint64 m_sizeSnapshotGeneration;
+
+    // Per-thread accumulation
+    std::atomic<bool> m_perThreadAccumulation;   // Read by ingest threads without m_mutex
+    quint64 m_instanceId;                        // Unique per engine, keys thread-local caches
+    QMutex m_accumulatorsMutex;                  // Guards the registry, not the accumulators
+    QHash<QThread *, std::shared_ptr<Accumulator>> m_accumulators;
+    std::shared_ptr<const Snapshot> m_snapshot; // Swapped atomically (RCU-style)
 };
 
 #endif // STATISTICSENGINE_H
@@ -0,0 +1,97 @@
+#ifndef STREAMREASSEMBLER_H
+#define STREAMREASSEMBLER_H
+
+#include <QByteArray>
+#include <QList>
+#include <QMap>
+#include <QPair>
+
+/**
+ * @brief Incremental reassembler for one direction of a TCP stream
+ *
+ * Sequence numbers are unwrapped into 64-bit offsets relative to the
+ * initial sequence number, so streams crossing the 2^32 boundary reassemble
+ * transparently. In-order payload and out-of-order segments are held as
+ * references into the packet buffers (implicitly shared QByteArrays) and
+ * only copied into one contiguous buffer when data() is read.
+ *
+ * Overlapping data is resolved in favour of the bytes that arrived first.
+ */
+class StreamReassembler {
+public:
+    enum SegmentResult {
+        InOrder,                     // Extended the contiguous stream
+        OutOfOrder,                  // Buffered ahead of a gap
+        Retransmission,              // No new bytes (fully overlapped)
+        Truncated                    // Dropped because of the size limit
+    };
+
+    explicit StreamReassembler(quint64 maxBytes = 10 * 1024 * 1024);
+
+    // Sequence space
+    void setInitialSequence(quint32 seq);
+    bool isInitialized() const { return m_initialized; }
+    quint32 initialSequence() const { return m_initialSeq; }
+    quint32 nextSequence() const;
+
+    // Segment input
+    SegmentResult addSegment(quint32 seq, const QByteArray &buffer, int offset, int length);
+    bool isRetransmission(quint32 seq, quint32 length) const;
+
+    // Gap handling
+    bool hasPending() const { return !m_pending.isEmpty(); }
+    bool hasGaps() const { return !m_pending.isEmpty() || !m_skipped.isEmpty(); }
+    QList<QPair<quint32, quint32>> gaps() const; // (start seq, length)
+    void skipGaps();
+
+    /**
+     * @brief Add every byte @p other holds for the same direction
+     *
+     * Used to stitch a stream seen by two partitions of one capture. Both
+     * reassemblers must share a sequence space; whichever starts earlier
+     * defines the stream start and overlaps keep the bytes already present.
+     */
+    void merge(const StreamReassembler &other);
+
+    // Data access. Both are cut at QByteArray's size limit (about 2 GB),
+    // which only an unlimited (maxBytes 0) stream can reach
+    QByteArray data() const;
+    // Contiguous data followed by the segments buffered behind gaps, with
+    // the holes left out (see gaps()); unlike skipGaps() it changes nothing
+    QByteArray flattenedData() const;
+    quint64 contiguousBytes() const { return m_contiguousBytes; }
+    quint64 bufferedBytes() const { return m_contiguousBytes + m_pendingBytes; }
+    bool isTruncated() const { return m_truncated; }
+
+    void setMaxBytes(quint64 maxBytes) { m_maxBytes = maxBytes; }
+    void clear();
+
+private:
+    struct Chunk {
+        QByteArray buffer;           // Shared packet buffer
+        int offset;                  // Payload start within buffer
+        int length;                  // Payload length
+
+        Chunk() : offset(0), length(0) {}
+        Chunk(const QByteArray &buf, int off, int len) : buffer(buf), offset(off), length(len) {}
+    };
+
+    qint64 toOffset(quint32 seq) const;
+    quint64 remainingBudget() const;
+    void appendContiguous(const Chunk &chunk);
+    void drainPending();
+
+    quint32 m_initialSeq;
+    bool m_initialized;
+    quint64 m_nextOffset;                        // Next expected stream offset
+    quint64 m_maxBytes;                          // 0 = unlimited
+    quint64 m_contiguousBytes;
+    quint64 m_pendingBytes;
+    bool m_truncated;
+
+    mutable QList<Chunk> m_chunks;               // In-order payload
+    QMap<quint64, Chunk> m_pending;              // Out-of-order, keyed by start offset
+    QList<QPair<quint64, quint64>> m_skipped;    // Skipped gaps (offset, length)
+};
+
+#endif // STREAMREASSEMBLER_H
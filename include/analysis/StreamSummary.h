@@ -0,0 +1,241 @@
+#ifndef STREAMSUMMARY_H
+#define STREAMSUMMARY_H
+
+#include <QHash>
+#include <QList>
+#include <QPair>
+#include <QVector>
+
+/**
+ * @brief Counters kept sorted by value with O(1) unit increments
+ *
+ * The "stream summary" structure from the Space-Saving paper: keys sharing
+ * a count are linked into one bucket and buckets are linked in ascending
+ * count order. Incrementing a key moves it to the neighbouring bucket, so
+ * the minimum and the top-K are available without scanning or sorting.
+ *
+ * Within a bucket, keys are kept in arrival order; minKey() returns the
+ * key that reached the minimum count first.
+ *
+ * With a non-zero capacity the summary is bounded Space-Saving: a new key
+ * arriving when full replaces the minimum key and inherits its count, so
+ * counts may overestimate by at most that minimum. Weighted add() walks
+ * upward from the key's bucket, bounded by the number of distinct counts.
+ */
+template <typename Key>
+class StreamSummary {
+public:
+    explicit StreamSummary(int capacity = 0)
+        : m_capacity(capacity), m_lowBucket(Nil), m_highBucket(Nil), m_freeItem(Nil),
+          m_freeBucket(Nil) {}
+
+    int capacity() const { return m_capacity; }             // 0 = unbounded
+
+    int size() const { return m_index.size(); }
+    bool isEmpty() const { return m_index.isEmpty(); }
+    bool contains(const Key &key) const { return m_index.contains(key); }
+
+    quint64 count(const Key &key) const {
+        auto it = m_index.constFind(key);
+        return it != m_index.constEnd() ? m_buckets.at(m_items.at(it.value()).bucket).count : 0;
+    }
+
+    /**
+     * @brief Add one to the count of @p key, inserting it with count 1
+     */
+    void increment(const Key &key) { add(key, 1); }
+
+    /**
+     * @brief Add @p amount to the count of @p key
+     *
+     * An absent key is inserted; when the summary is at capacity it takes
+     * over the slot and count of the current minimum key.
+     */
+    void add(const Key &key, quint64 amount) {
+        if (amount == 0) return;
+
+        auto it = m_index.constFind(key);
+        if (it == m_index.constEnd()) {
+            quint64 base = 0;
+            if (m_capacity > 0 && m_index.size() >= m_capacity) {
+                base = minCount();
+                remove(minKey());
+            }
+            insert(key, base + amount);
+            return;
+        }
+
+        const int item = it.value();
+        const int from = m_items.at(item).bucket;
+        const quint64 target = m_buckets.at(from).count + amount;
+        int prev = from;
+        int next = m_buckets.at(from).next;
+        while (next != Nil && m_buckets.at(next).count < target) {
+            prev = next;
+            next = m_buckets.at(next).next;
+        }
+        int to = next;
+        if (to == Nil || m_buckets.at(to).count != target) {
+            to = allocBucket(target, prev, next);
+        }
+        unlinkItem(item);
+        linkItem(item, to);
+        if (m_buckets.at(from).head == Nil) {
+            freeBucket(from);
+        }
+    }
+
+    /**
+     * @brief Insert @p key with an explicit starting count
+     */
+    void insert(const Key &key, quint64 count) {
+        if (m_index.contains(key)) remove(key);
+
+        // Find the first bucket with count >= target (usually the low end)
+        int prev = Nil;
+        int next = m_lowBucket;
+        while (next != Nil && m_buckets.at(next).count < count) {
+            prev = next;
+            next = m_buckets.at(next).next;
+        }
+        int bucket = next;
+        if (bucket == Nil || m_buckets.at(bucket).count != count) {
+            bucket = allocBucket(count, prev, next);
+        }
+
+        const int item = allocItem(key);
+        linkItem(item, bucket);
+        m_index.insert(key, item);
+    }
+
+    bool remove(const Key &key) {
+        auto it = m_index.find(key);
+        if (it == m_index.end()) return false;
+
+        const int item = it.value();
+        m_index.erase(it);
+        const int bucket = m_items.at(item).bucket;
+        unlinkItem(item);
+        if (m_buckets.at(bucket).head == Nil) {
+            freeBucket(bucket);
+        }
+        m_items[item].key = Key();
+        m_items[item].next = m_freeItem;
+        m_freeItem = item;
+        return true;
+    }
+
+    Key minKey() const {
+        return m_lowBucket != Nil ? m_items.at(m_buckets.at(m_lowBucket).head).key : Key();
+    }
+
+    quint64 minCount() const {
+        return m_lowBucket != Nil ? m_buckets.at(m_lowBucket).count : 0;
+    }
+
+    /**
+     * @brief Keys with the highest counts, descending; O(count)
+     */
+    QList<QPair<Key, quint64>> top(int count) const {
+        QList<QPair<Key, quint64>> result;
+        for (int b = m_highBucket; b != Nil && result.size() < count; b = m_buckets.at(b).prev) {
+            for (int i = m_buckets.at(b).head; i != Nil && result.size() < count;
+                 i = m_items.at(i).next) {
+                result.append(qMakePair(m_items.at(i).key, m_buckets.at(b).count));
+            }
+        }
+        return result;
+    }
+
+    void clear() {
+        m_index.clear();
+        m_items.clear();
+        m_buckets.clear();
+        m_lowBucket = m_highBucket = m_freeItem = m_freeBucket = Nil;
+    }
+
+private:
+    enum { Nil = -1 };
+
+    struct Item {
+        Key key;
+        int bucket;
+        int prev;
+        int next;
+    };
+
+    struct Bucket {
+        quint64 count;
+        int head;
+        int tail;
+        int prev;                    // Lower count
+        int next;                    // Higher count
+    };
+
+    int allocItem(const Key &key) {
+        int item = m_freeItem;
+        if (item != Nil) {
+            m_freeItem = m_items.at(item).next;
+        } else {
+            item = m_items.size();
+            m_items.append(Item());
+        }
+        m_items[item].key = key;
+        return item;
+    }
+
+    int allocBucket(quint64 count, int prev, int next) {
+        int bucket = m_freeBucket;
+        if (bucket != Nil) {
+            m_freeBucket = m_buckets.at(bucket).next;
+        } else {
+            bucket = m_buckets.size();
+            m_buckets.append(Bucket());
+        }
+        Bucket &b = m_buckets[bucket];
+        b.count = count;
+        b.head = b.tail = Nil;
+        b.prev = prev;
+        b.next = next;
+        if (prev != Nil) m_buckets[prev].next = bucket; else m_lowBucket = bucket;
+        if (next != Nil) m_buckets[next].prev = bucket; else m_highBucket = bucket;
+        return bucket;
+    }
+
+    void freeBucket(int bucket) {
+        const int prev = m_buckets.at(bucket).prev;
+        const int next = m_buckets.at(bucket).next;
+        if (prev != Nil) m_buckets[prev].next = next; else m_lowBucket = next;
+        if (next != Nil) m_buckets[next].prev = prev; else m_highBucket = prev;
+        m_buckets[bucket].next = m_freeBucket;
+        m_freeBucket = bucket;
+    }
+
+    void linkItem(int item, int bucket) {
+        Bucket &b = m_buckets[bucket];
+        Item &it = m_items[item];
+        it.bucket = bucket;
+        it.prev = b.tail;
+        it.next = Nil;
+        if (b.tail != Nil) m_items[b.tail].next = item; else b.head = item;
+        b.tail = item;
+    }
+
+    void unlinkItem(int item) {
+        const Item &it = m_items.at(item);
+        Bucket &b = m_buckets[it.bucket];
+        if (it.prev != Nil) m_items[it.prev].next = it.next; else b.head = it.next;
+        if (it.next != Nil) m_items[it.next].prev = it.prev; else b.tail = it.prev;
+    }
+
+    int m_capacity;
+    QHash<Key, int> m_index;
+    QVector<Item> m_items;
+    QVector<Bucket> m_buckets;
+    int m_lowBucket;
+    int m_highBucket;
+    int m_freeItem;
+    int m_freeBucket;
+};
+
+#endif // STREAMSUMMARY_H
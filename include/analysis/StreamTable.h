@@ -0,0 +1,58 @@
+#ifndef STREAMTABLE_H
+#define STREAMTABLE_H
+
+#include <QHash>
+#include <QVector>
+#include "ConversationTracker.h"
+#include "StreamReassembler.h"
+#include "TcpAnalyzer.h"
+
+/**
+ * @brief Slab storage for TCP streams and their reassembly state
+ *
+ * A stream, its TCP analysis state and the reassemblers of both directions
+ * share one record in a
+ * slab addressed by stable slots; the stream index maps to a slot and freed
+ * slots are reused, so stream churn does not fragment the heap. Record
+ * pointers stay valid until the next insert.
+ */
+class StreamTable {
+public:
+    struct Record {
+        TcpStream stream;
+        StreamReassembler client;    // Client to server
+        StreamReassembler server;    // Server to client
+        TcpAnalyzer analyzer;
+    };
+
+    int size() const { return m_index.size(); }
+    bool isEmpty() const { return m_index.isEmpty(); }
+    bool contains(quint32 streamIndex) const { return m_index.contains(streamIndex); }
+    void clear();
+
+    Record *find(quint32 streamIndex);
+    const Record *find(quint32 streamIndex) const;
+    Record &insert(const TcpStream &stream, quint64 maxBytes);
+    void remove(quint32 streamIndex);
+
+    template <typename Fn>
+    void forEach(Fn fn) {
+        for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+            fn(m_records[it.value()]);
+        }
+    }
+
+    template <typename Fn>
+    void forEach(Fn fn) const {
+        for (auto it = m_index.constBegin(); it != m_index.constEnd(); ++it) {
+            fn(m_records.at(it.value()));
+        }
+    }
+
+private:
+    QHash<quint32, quint32> m_index;             // Key: stream index, Value: slot
+    QVector<Record> m_records;
+    QVector<quint32> m_freeSlots;
+};
+
+#endif // STREAMTABLE_H
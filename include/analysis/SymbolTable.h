@@ -0,0 +1,82 @@
+#ifndef SYMBOLTABLE_H
+#define SYMBOLTABLE_H
+
+#include <QHash>
+#include <QReadWriteLock>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief Reference-counted interning of strings to dense 32-bit IDs
+ *
+ * Each engine owns its tables, so an ID only means something to the engine
+ * that issued it; ID 0 is the empty string. A name is dropped once its last
+ * reference is released, and its ID is then reused for the next new name,
+ * which keeps the table bounded by the names currently held.
+ *
+ * Every call takes the table's lock. Hot paths resolve names through a
+ * SymbolCache instead, which only reaches the table on a miss.
+ */
+class SymbolTable {
+public:
+    static const quint32 EmptyId = 0;
+
+    SymbolTable();
+
+    quint32 acquire(const QString &name);                 // Interns and takes a reference
+    void release(quint32 id);                             // Drops the name with its last reference
+    bool lookup(const QString &name, quint32 *id) const;  // Never inserts
+    QString name(quint32 id) const;                       // Empty once released
+    int size() const;                                     // Names held, including the empty one
+
+    // Table-independent 64-bit key of a name, 0 for the empty name
+    static quint64 key(const QString &name);
+
+private:
+    Q_DISABLE_COPY(SymbolTable)
+
+    mutable QReadWriteLock m_lock;
+    QHash<QString, quint32> m_ids;
+    QVector<QString> m_names;                             // Index: ID
+    QVector<quint32> m_references;                        // Index: ID
+    QVector<quint32> m_freeIds;
+};
+
+/**
+ * @brief An interned name as seen by one cache
+ *
+ * Sketches hash the key rather than the ID, so they stay valid when an ID is
+ * reused and merge across engines with different tables.
+ */
+struct Symbol {
+    quint32 id;
+    quint64 key;
+
+    Symbol() : id(SymbolTable::EmptyId), key(0) {}
+};
+
+/**
+ * @brief Unlocked per-shard or per-thread front of a SymbolTable
+ *
+ * Holds one table reference for every name it has resolved, so its IDs stay
+ * valid without the table's lock. Not thread-safe; the owner guards it.
+ */
+class SymbolCache {
+public:
+    explicit SymbolCache(SymbolTable *table);
+    ~SymbolCache();
+
+    Symbol intern(const QString &name);
+    void forget(const QString &name);                     // Releases the name's reference
+    void clear();                                         // Releases every reference
+    void swap(SymbolCache &other);
+    int size() const { return m_symbols.size(); }
+
+private:
+    Q_DISABLE_COPY(SymbolCache)
+
+    SymbolTable *m_table;
+    QHash<QString, Symbol> m_symbols;
+};
+
+#endif // SYMBOLTABLE_H
@@ -0,0 +1,87 @@
+#ifndef TCPANALYZER_H
+#define TCPANALYZER_H
+
+#include <QtGlobal>
+#include "ConversationTracker.h"
+
+struct TcpHeader;
+
+/**
+ * @brief Incremental TCP performance analysis of one stream
+ *
+ * Works from sequence and acknowledgement numbers alone, so it needs no
+ * captured payload and keeps a fixed amount of state per direction:
+ *
+ * - A segment ending at or below the highest sequence sent so far is a
+ *   retransmission, unless it arrives within one round trip of that highest
+ *   segment, in which case it was reordered on the way (out of order).
+ * - One segment per direction is timed to the ACK that covers it; timing
+ *   is abandoned when the direction retransmits (Karn's algorithm).
+ * - An ACK that repeats the previous one, with the same window, no data
+ *   and data outstanding is a duplicate ACK (RFC 5681).
+ * - Goodput is the advance of the peer's cumulative ACK.
+ *
+ * Results are written to TcpStream::metrics and the stream's
+ * retransmission and out-of-order totals.
+ */
+class TcpAnalyzer {
+public:
+    enum Segment {
+        NoData,                      // Pure ACK, RST or window update
+        NewData,                     // Advanced the highest sequence sent
+        Retransmission,
+        OutOfOrder,
+        KeepAlive                    // One byte below the next sequence
+    };
+
+    enum {
+        GoodputBuckets = 32,
+        InitialGoodputIntervalUs = 100000
+    };
+
+    TcpAnalyzer();
+
+    Segment addSegment(TcpStream &stream, bool clientToServer, qint64 timeUs,
+                       const TcpHeader &tcp);
+    void clear();
+
+    /**
+     * @brief Fold the metrics of the same stream seen by another partition
+     *
+     * Counters add, RTT extremes combine and the smoothed RTT is weighted by
+     * sample count. Both goodput series are re-bucketed from the earlier of
+     * the two start times.
+     */
+    static void mergeMetrics(TcpMetrics &into, qint64 intoStartUs, const TcpMetrics &from,
+                             qint64 fromStartUs);
+
+private:
+    struct Direction {
+        quint32 highestSeq;          // End of the highest segment sent
+        qint64 highestUs;            // When it was seen
+        quint32 ackedSeq;            // Highest sequence the peer acknowledged
+        quint32 lastAck;             // Last ACK this direction sent
+        quint16 lastWindow;
+        quint32 timedSeq;            // End of the segment being timed
+        qint64 timedUs;
+        qint64 synUs;                // -1 if no SYN was seen
+        bool seqValid;
+        bool ackedValid;
+        bool ackValid;
+        bool timing;
+        bool timedSyn;
+        bool zeroWindow;             // Advertising a zero window
+
+        Direction();
+    };
+
+    Segment classify(Direction &sender, TcpDirectionMetrics &metrics, qint64 timeUs,
+                     const TcpHeader &tcp, qint64 reorderUs);
+    void acknowledge(TcpStream &stream, bool clientToServer, Direction &sender, Direction &peer,
+                     qint64 timeUs, const TcpHeader &tcp);
+
+    Direction m_client;              // Client to server
+    Direction m_server;              // Server to client
+};
+
+#endif // TCPANALYZER_H
@@ -0,0 +1,63 @@
+#ifndef TCPHEADER_H
+#define TCPHEADER_H
+
+#include <QtGlobal>
+#include "../models/PacketModel.h"
+
+/**
+ * @brief Decoded, fixed-layout view of a packet's TCP header
+ *
+ * Decoded once per packet so the tracker reads plain fields instead of
+ * string-keyed customFields lookups. The header is parsed from rawData
+ * (Ethernet II with optional VLAN tags, Linux cooked capture, or raw IP);
+ * packets whose frames cannot be parsed fall back to the dissector's
+ * customFields, looking each key up once.
+ */
+struct TcpHeader {
+    enum Flag : quint8 {
+        Fin = 0x01,
+        Syn = 0x02,
+        Rst = 0x04,
+        Psh = 0x08,
+        Ack = 0x10,
+        Urg = 0x20,
+        Ece = 0x40,
+        Cwr = 0x80
+    };
+
+    quint32 seq;
+    quint32 ack;
+    quint32 payloadLength;           // TCP payload bytes (from the IP length)
+    int payloadOffset;               // Payload start in rawData, -1 if not captured
+    quint16 window;                  // Raw window field (unscaled)
+    quint8 flags;                    // Flag bitmask
+    bool valid;                      // Header was decoded from either source
+
+    TcpHeader() : seq(0), ack(0), payloadLength(0), payloadOffset(-1), window(0),
+                  flags(0), valid(false) {}
+
+    bool has(Flag flag) const { return (flags & flag) != 0; }
+
+    static TcpHeader fromPacket(const PacketModel &packet);
+
+private:
+    static bool decodeRaw(const PacketModel &packet, TcpHeader *header);
+    static void decodeFields(const PacketModel &packet, TcpHeader *header);
+};
+
+/**
+ * @brief Payload location of a packet's UDP datagram
+ *
+ * Parsed from rawData like TcpHeader; there is no customFields fallback.
+ */
+struct UdpHeader {
+    quint32 payloadLength;           // From the UDP length field
+    int payloadOffset;               // Payload start in rawData, -1 if not captured
+    bool valid;
+
+    UdpHeader() : payloadLength(0), payloadOffset(-1), valid(false) {}
+
+    static UdpHeader fromPacket(const PacketModel &packet);
+};
+
+#endif // TCPHEADER_H
@@ -0,0 +1,48 @@
+#ifndef TIMESTAMP_H
+#define TIMESTAMP_H
+
+#include <QDateTime>
+#include <QVector>
+#include <limits>
+#include "../models/PacketModel.h"
+
+/**
+ * @brief Integer microsecond timestamps used inside the analysis engines
+ *
+ * The engines keep all timing as microseconds since the epoch and make a
+ * QDateTime only when a value is read. InvalidTimestamp means "not seen
+ * yet" and compares below every real time.
+ */
+const qint64 InvalidTimestamp = std::numeric_limits<qint64>::min();
+
+// Floor division; written so that InvalidTimestamp cannot overflow
+inline qint64 timestampMs(qint64 us) {
+    return us >= 0 ? us / 1000 : (us + 1) / 1000 - 1;
+}
+
+inline qint64 timestampUs(const QDateTime &time) {
+    return time.isValid() ? time.toMSecsSinceEpoch() * 1000 : InvalidTimestamp;
+}
+
+inline QDateTime dateTimeFromUs(qint64 us) {
+    return us != InvalidTimestamp ? QDateTime::fromMSecsSinceEpoch(timestampMs(us)) : QDateTime();
+}
+
+/**
+ * @brief A packet's capture time, converted once at ingest
+ *
+ * PacketModel carries a millisecond QDateTime. Sources with finer times,
+ * such as pcap replay, pass them to the engines' addPackets() alongside
+ * the batch; see batchTimestampUs().
+ */
+inline qint64 packetTimestampUs(const PacketModel &packet) {
+    return timestampUs(packet.timestamp);
+}
+
+// Capture time of the packet at @p index of a batch. @p timesUs is either
+// empty or holds one microsecond time per packet, which takes precedence
+inline qint64 batchTimestampUs(const PacketModel &packet, const QVector<qint64> &timesUs, int index) {
+    return index < timesUs.size() ? timesUs.at(index) : packetTimestampUs(packet);
+}
+
+#endif // TIMESTAMP_H
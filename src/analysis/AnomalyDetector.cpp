@@ -0,0 +1,82 @@
+#include "analysis/AnomalyDetector.h"
+#include <cmath>
+#include <limits>
+
+namespace {
+
+// Variance floor, so a perfectly steady baseline does not score any change as infinite
+const double MinimumVariance = 1.0;
+
+} // namespace
+
+AnomalyDetector::AnomalyDetector(const Settings &settings)
+    : m_settings(settings)
+{
+}
+
+double AnomalyDetector::fold(Baseline &baseline, double value) const {
+    double score = 0.0;
+    if (baseline.intervals == 0) {
+        baseline.mean = value;
+    } else {
+        const double deviation = value - baseline.mean;
+        score = deviation / std::sqrt(qMax(baseline.variance, MinimumVariance));
+
+        // Incremental EWMA of mean and variance (West's update)
+        const double increment = m_settings.smoothing * deviation;
+        baseline.mean += increment;
+        baseline.variance = (1.0 - m_settings.smoothing) * (baseline.variance + deviation * increment);
+    }
+    if (baseline.intervals < std::numeric_limits<quint32>::max()) {
+        baseline.intervals++;
+    }
+    return score;
+}
+
+bool AnomalyDetector::observe(Baseline &baseline, quint64 count, quint64 minimum,
+                              AnomalyAlert *alert) const {
+    const double expected = baseline.mean;
+    const bool warm = baseline.intervals >= static_cast<quint32>(m_settings.warmupIntervals);
+    const double score = fold(baseline, static_cast<double>(count));
+    if (!warm || count < minimum || score < m_settings.threshold) return false;
+
+    alert->type = AnomalyAlert::TrafficSpike;
+    alert->observed = static_cast<double>(count);
+    alert->expected = expected;
+    alert->score = score;
+    return true;
+}
+
+void AnomalyDetector::observeIdle(Baseline &baseline, qint64 intervals) const {
+    const qint64 folded = qMin<qint64>(intervals, m_settings.warmupIntervals);
+    for (qint64 i = 0; i < folded; ++i) {
+        fold(baseline, 0.0);
+    }
+}
+
+bool AnomalyDetector::observeScan(Baseline &baseline, quint64 newPorts, AnomalyAlert *alert) const {
+    const double expected = baseline.mean;
+    const bool warm = baseline.intervals >= static_cast<quint32>(m_settings.warmupIntervals);
+    const double score = fold(baseline, static_cast<double>(newPorts));
+    if (newPorts < m_settings.minimumScanPorts) return false;
+    if (warm && score < m_settings.threshold) return false;
+
+    alert->type = AnomalyAlert::PortScan;
+    alert->observed = static_cast<double>(newPorts);
+    alert->expected = expected;
+    alert->score = score;
+    return true;
+}
+
+bool AnomalyDetector::observeHandshakes(quint64 syns, quint64 synAcks, AnomalyAlert *alert) const {
+    if (syns < m_settings.minimumSyns) return false;
+    const quint64 unanswered = syns > synAcks ? syns - synAcks : 0;
+    const double ratio = static_cast<double>(unanswered) / qMax<quint64>(synAcks, 1);
+    if (ratio < m_settings.synFloodRatio) return false;
+
+    alert->type = AnomalyAlert::SynFlood;
+    alert->observed = static_cast<double>(syns);
+    alert->expected = static_cast<double>(synAcks);
+    alert->score = ratio;
+    return true;
+}
@@ -0,0 +1,505 @@
+#include "analysis/CaptureReplay.h"
+#include "analysis/Timestamp.h"
+#include <QHostAddress>
+#include <cmath>
+
+namespace {
+
+// pcap magic numbers, as read little-endian
+const quint32 PcapMagicMicro = 0xA1B2C3D4;
+const quint32 PcapMagicNano = 0xA1B23C4D;
+const quint32 PcapMagicMicroSwapped = 0xD4C3B2A1;
+const quint32 PcapMagicNanoSwapped = 0x4D3CB2A1;
+const int PcapFileHeaderSize = 24;
+const int PcapRecordHeaderSize = 16;
+
+// pcapng block types
+const quint32 BlockSectionHeader = 0x0A0D0D0A;
+const quint32 BlockInterfaceDescription = 0x00000001;
+const quint32 BlockSimplePacket = 0x00000003;
+const quint32 BlockEnhancedPacket = 0x00000006;
+const quint32 ByteOrderMagic = 0x1A2B3C4D;
+const quint32 ByteOrderMagicSwapped = 0x4D3C2B1A;
+const quint16 OptionEnd = 0;
+const quint16 OptionTimestampResolution = 9;
+const quint8 DefaultTimestampResolution = 6;      // Microseconds
+
+// Link types
+const quint16 LinkNull = 0;
+const quint16 LinkEthernet = 1;
+const quint16 LinkRaw = 101;
+const quint16 LinkLoop = 108;
+const quint16 LinkLinuxSll = 113;
+const quint16 LinkIPv4 = 228;
+const quint16 LinkIPv6 = 229;
+const quint16 LinkLinuxSll2 = 276;
+
+const quint16 EtherTypeIPv4 = 0x0800;
+const quint16 EtherTypeArp = 0x0806;
+const quint16 EtherTypeIPv6 = 0x86DD;
+const quint16 EtherTypeVlan = 0x8100;
+const quint16 EtherTypeQinQ = 0x88A8;
+
+const quint8 IpProtoIcmp = 1;
+const quint8 IpProtoIgmp = 2;
+const quint8 IpProtoTcp = 6;
+const quint8 IpProtoUdp = 17;
+const quint8 IpProtoGre = 47;
+const quint8 IpProtoEsp = 50;
+const quint8 IpProtoIcmpV6 = 58;
+const quint8 IpProtoSctp = 132;
+
+// Address caches are dropped when they reach this many entries
+const int MaxCachedAddresses = 1 << 20;
+
+inline quint16 readBE16(const uchar *p) {
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+inline quint32 readLE32(const uchar *p) {
+    return static_cast<quint32>(p[0]) | (static_cast<quint32>(p[1]) << 8) |
+           (static_cast<quint32>(p[2]) << 16) | (static_cast<quint32>(p[3]) << 24);
+}
+
+inline quint64 readBE64(const uchar *p) {
+    quint64 value = 0;
+    for (int i = 0; i < 8; ++i) {
+        value = (value << 8) | p[i];
+    }
+    return value;
+}
+
+// pcapng timestamps count units of 10^-n or 2^-n seconds
+qint64 timestampToUs(quint64 units, quint8 resolution) {
+    if (resolution & 0x80) {
+        const int shift = resolution & 0x7F;
+        if (shift >= 64) return 0;
+        const quint64 seconds = units >> shift;
+        const quint64 fraction = units & ((quint64(1) << shift) - 1);
+        return static_cast<qint64>(seconds * 1000000 +
+                                   static_cast<quint64>(std::ldexp(double(fraction) * 1e6, -shift)));
+    }
+
+    qint64 value = static_cast<qint64>(units);
+    for (int exponent = resolution; exponent > 6; --exponent) value /= 10;
+    for (int exponent = resolution; exponent < 6; ++exponent) value *= 10;
+    return value;
+}
+
+const QString &protocolName(const PacketView &view) {
+    static const QString tcp = QStringLiteral("TCP");
+    static const QString udp = QStringLiteral("UDP");
+    static const QString icmp = QStringLiteral("ICMP");
+    static const QString icmpV6 = QStringLiteral("ICMPv6");
+    static const QString igmp = QStringLiteral("IGMP");
+    static const QString gre = QStringLiteral("GRE");
+    static const QString esp = QStringLiteral("ESP");
+    static const QString sctp = QStringLiteral("SCTP");
+    static const QString ipv4 = QStringLiteral("IPv4");
+    static const QString ipv6 = QStringLiteral("IPv6");
+    static const QString arp = QStringLiteral("ARP");
+    static const QString other = QStringLiteral("Unknown");
+
+    if (view.ipVersion == 0) {
+        return view.etherType == EtherTypeArp ? arp : other;
+    }
+    switch (view.ipProtocol) {
+    case IpProtoTcp: return tcp;
+    case IpProtoUdp: return udp;
+    case IpProtoIcmp: return icmp;
+    case IpProtoIcmpV6: return icmpV6;
+    case IpProtoIgmp: return igmp;
+    case IpProtoGre: return gre;
+    case IpProtoEsp: return esp;
+    case IpProtoSctp: return sctp;
+    default: return view.ipVersion == 4 ? ipv4 : ipv6;
+    }
+}
+
+} // namespace
+
+CaptureReplay::CaptureReplay(const QString &filePath)
+    : m_file(filePath)
+    , m_data(nullptr)
+    , m_size(0)
+    , m_pos(0)
+    , m_format(UnknownFormat)
+    , m_bigEndian(false)
+    , m_nanosecond(false)
+    , m_linkType(0)
+    , m_lastTimestampUs(0)
+    , m_packetCount(0)
+{
+}
+
+CaptureReplay::~CaptureReplay() {
+    close();
+}
+
+bool CaptureReplay::open() {
+    close();
+    m_error.clear();
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        return fail(m_file.errorString());
+    }
+    m_size = m_file.size();
+    if (m_size < 4) {
+        return fail(QStringLiteral("File is too short to be a capture"));
+    }
+    m_data = m_file.map(0, m_size);
+    if (!m_data) {
+        return fail(m_file.errorString());
+    }
+    return readFileHeader();
+}
+
+void CaptureReplay::close() {
+    if (m_data) {
+        m_file.unmap(m_data);
+        m_data = nullptr;
+    }
+    m_file.close();
+    m_size = 0;
+    m_pos = 0;
+    m_format = UnknownFormat;
+    m_interfaces.clear();
+    m_packetCount = 0;
+}
+
+bool CaptureReplay::fail(const QString &error) {
+    m_error = error;
+    if (m_format == UnknownFormat) {
+        close();
+    }
+    return false;
+}
+
+bool CaptureReplay::readFileHeader() {
+    const quint32 magic = readLE32(m_data);
+
+    if (magic == BlockSectionHeader) {
+        m_format = PcapNg;                        // Byte order is read per section
+        return true;
+    }
+
+    if (magic == PcapMagicMicro || magic == PcapMagicNano ||
+        magic == PcapMagicMicroSwapped || magic == PcapMagicNanoSwapped) {
+        if (m_size < PcapFileHeaderSize) {
+            return fail(QStringLiteral("Truncated pcap file header"));
+        }
+        m_bigEndian = (magic == PcapMagicMicroSwapped || magic == PcapMagicNanoSwapped);
+        m_nanosecond = (magic == PcapMagicNano || magic == PcapMagicNanoSwapped);
+        m_linkType = static_cast<quint16>(read32(m_data + 20) & 0xFFFF); // Upper bits: FCS info
+        m_pos = PcapFileHeaderSize;
+        m_format = Pcap;
+        return true;
+    }
+
+    return fail(QStringLiteral("Not a pcap or pcapng file"));
+}
+
+quint16 CaptureReplay::read16(const uchar *p) const {
+    return m_bigEndian ? readBE16(p) : static_cast<quint16>(p[0] | (p[1] << 8));
+}
+
+quint32 CaptureReplay::read32(const uchar *p) const {
+    if (m_bigEndian) {
+        return (static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) |
+               (static_cast<quint32>(p[2]) << 8) | static_cast<quint32>(p[3]);
+    }
+    return readLE32(p);
+}
+
+bool CaptureReplay::next(PacketView *view) {
+    if (!m_data) return false;
+    *view = PacketView();
+    const bool found = (m_format == Pcap) ? nextPcap(view) : nextPcapNg(view);
+    if (!found) return false;
+
+    view->number = ++m_packetCount;
+    decode(view);
+    return true;
+}
+
+int CaptureReplay::readViews(QVector<PacketView> *views, int maxCount) {
+    views->clear();
+    PacketView view;
+    while (views->size() < maxCount && next(&view)) {
+        views->append(view);
+    }
+    return views->size();
+}
+
+QList<std::shared_ptr<PacketModel>> CaptureReplay::readBatch(int maxCount,
+                                                             QVector<qint64> *timestampsUs) {
+    QList<std::shared_ptr<PacketModel>> packets;
+    packets.reserve(maxCount);
+    if (timestampsUs) {
+        timestampsUs->clear();
+        timestampsUs->reserve(maxCount);
+    }
+    PacketView view;
+    while (packets.size() < maxCount && next(&view)) {
+        packets.append(toPacket(view));
+        if (timestampsUs) {
+            timestampsUs->append(view.timestampUs);
+        }
+    }
+    return packets;
+}
+
+bool CaptureReplay::nextPcap(PacketView *view) {
+    if (m_pos == m_size) return false;
+    if (m_size - m_pos < PcapRecordHeaderSize) {
+        return fail(QStringLiteral("Truncated record header at offset %1").arg(m_pos));
+    }
+
+    const uchar *header = m_data + m_pos;
+    const quint32 seconds = read32(header);
+    const quint32 fraction = read32(header + 4);
+    const quint32 capturedLength = read32(header + 8);
+    if (capturedLength > m_size - m_pos - PcapRecordHeaderSize) {
+        return fail(QStringLiteral("Truncated record at offset %1").arg(m_pos));
+    }
+
+    view->data = header + PcapRecordHeaderSize;
+    view->capturedLength = capturedLength;
+    view->originalLength = read32(header + 12);
+    view->timestampUs = static_cast<qint64>(seconds) * 1000000 +
+                        (m_nanosecond ? fraction / 1000 : fraction);
+    view->linkType = m_linkType;
+    m_pos += PcapRecordHeaderSize + capturedLength;
+    return true;
+}
+
+bool CaptureReplay::nextPcapNg(PacketView *view) {
+    while (m_pos < m_size) {
+        if (m_size - m_pos < 12) {
+            return fail(QStringLiteral("Truncated block at offset %1").arg(m_pos));
+        }
+
+        const uchar *block = m_data + m_pos;
+        const quint32 type = read32(block);
+        if (type == BlockSectionHeader) {
+            // A new section may switch byte order and resets the interfaces
+            const quint32 magic = readLE32(block + 8);
+            if (magic != ByteOrderMagic && magic != ByteOrderMagicSwapped) {
+                return fail(QStringLiteral("Corrupt section header at offset %1").arg(m_pos));
+            }
+            m_bigEndian = (magic == ByteOrderMagicSwapped);
+            m_interfaces.clear();
+        }
+
+        const quint32 blockLength = read32(block + 4);
+        if (blockLength < 12 || (blockLength & 3) || blockLength > m_size - m_pos) {
+            return fail(QStringLiteral("Corrupt block at offset %1").arg(m_pos));
+        }
+        const uchar *body = block + 8;
+        const quint32 bodyLength = blockLength - 12;
+        m_pos += blockLength;
+
+        if (type == BlockInterfaceDescription) {
+            readInterface(body, bodyLength);
+        } else if (type == BlockEnhancedPacket) {
+            if (bodyLength < 20) continue;
+            const quint32 interfaceId = read32(body);
+            const quint32 capturedLength = read32(body + 12);
+            if (interfaceId >= static_cast<quint32>(m_interfaces.size()) ||
+                capturedLength > bodyLength - 20) {
+                continue;
+            }
+            const Interface &iface = m_interfaces.at(static_cast<int>(interfaceId));
+            const quint64 units = (static_cast<quint64>(read32(body + 4)) << 32) | read32(body + 8);
+
+            view->data = body + 20;
+            view->capturedLength = capturedLength;
+            view->originalLength = read32(body + 16);
+            view->timestampUs = timestampToUs(units, iface.timestampResolution);
+            view->linkType = iface.linkType;
+            m_lastTimestampUs = view->timestampUs;
+            return true;
+        } else if (type == BlockSimplePacket) {
+            // No timestamp and always interface 0
+            if (bodyLength < 4 || m_interfaces.isEmpty()) continue;
+            const quint32 originalLength = read32(body);
+
+            view->data = body + 4;
+            view->capturedLength = qMin(originalLength, bodyLength - 4);
+            view->originalLength = originalLength;
+            view->timestampUs = m_lastTimestampUs;
+            view->linkType = m_interfaces.first().linkType;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CaptureReplay::readInterface(const uchar *body, quint32 length) {
+    Interface iface;
+    iface.linkType = length >= 2 ? read16(body) : 0;
+    iface.timestampResolution = DefaultTimestampResolution;
+
+    // Options follow link type, reserved and snap length
+    quint32 offset = 8;
+    while (offset + 4 <= length) {
+        const quint16 code = read16(body + offset);
+        const quint16 optionLength = read16(body + offset + 2);
+        offset += 4;
+        if (code == OptionEnd || offset + optionLength > length) break;
+        if (code == OptionTimestampResolution && optionLength >= 1) {
+            iface.timestampResolution = body[offset];
+        }
+        offset += (optionLength + 3u) & ~3u;
+    }
+    m_interfaces.append(iface);
+}
+
+void CaptureReplay::decode(PacketView *view) {
+    const uchar *data = view->data;
+    const int size = static_cast<int>(view->capturedLength);
+    int offset = -1;
+
+    switch (view->linkType) {
+    case LinkEthernet:
+        if (size >= 14) {
+            offset = 12;
+            view->etherType = readBE16(data + offset);
+            while ((view->etherType == EtherTypeVlan || view->etherType == EtherTypeQinQ) &&
+                   offset + 6 <= size) {
+                offset += 4;
+                view->etherType = readBE16(data + offset);
+            }
+            offset += 2;
+        }
+        break;
+    case LinkLinuxSll:
+        if (size >= 16) {
+            view->etherType = readBE16(data + 14);
+            offset = 16;
+        }
+        break;
+    case LinkLinuxSll2:
+        if (size >= 20) {
+            view->etherType = readBE16(data);
+            offset = 20;
+        }
+        break;
+    case LinkNull:
+    case LinkLoop:
+        if (size >= 4) offset = 4;               // Address family word; the IP version decides
+        break;
+    case LinkRaw:
+    case LinkIPv4:
+    case LinkIPv6:
+        offset = 0;
+        break;
+    default:
+        break;
+    }
+
+    if (offset < 0) return;
+    if (view->etherType == 0 && offset < size) {
+        const int version = data[offset] >> 4;
+        view->etherType = version == 4 ? EtherTypeIPv4 : (version == 6 ? EtherTypeIPv6 : 0);
+    }
+
+    int transport = -1;
+    if (view->etherType == EtherTypeIPv4) {
+        if (offset + 20 > size) {
+            view->truncated = true;
+            return;
+        }
+        const int headerLength = (data[offset] & 0x0F) * 4;
+        if (headerLength < 20) return;
+        view->ipVersion = 4;
+        view->ipOffset = offset;
+        view->ipProtocol = data[offset + 9];
+        if ((readBE16(data + offset + 6) & 0x1FFF) == 0) { // Ports only in the first fragment
+            transport = offset + headerLength;
+        }
+    } else if (view->etherType == EtherTypeIPv6) {
+        if (offset + 40 > size) {
+            view->truncated = true;
+            return;
+        }
+        view->ipVersion = 6;
+        view->ipOffset = offset;
+        quint8 next = data[offset + 6];
+        transport = offset + 40;
+        // Hop-by-hop, routing, fragment and destination options extension headers
+        while (next == 0 || next == 43 || next == 44 || next == 60) {
+            if (transport + 8 > size) {
+                view->truncated = true;
+                transport = -1;
+                break;
+            }
+            if (next == 44 && (readBE16(data + transport + 2) & 0xFFF8)) {
+                next = data[transport];
+                transport = -1;                   // Later fragment: no transport header
+                break;
+            }
+            const int length = next == 44 ? 8 : (data[transport + 1] + 1) * 8;
+            next = data[transport];
+            transport += length;
+        }
+        view->ipProtocol = next;
+    } else {
+        return;
+    }
+
+    if (transport < 0) return;
+    view->transportOffset = transport;
+    if (view->ipProtocol == IpProtoTcp || view->ipProtocol == IpProtoUdp ||
+        view->ipProtocol == IpProtoSctp) {
+        if (transport + 4 > size) {
+            view->truncated = true;
+            return;
+        }
+        view->srcPort = readBE16(data + transport);
+        view->dstPort = readBE16(data + transport + 2);
+    }
+}
+
+std::shared_ptr<PacketModel> CaptureReplay::toPacket(const PacketView &view) {
+    auto packet = std::make_shared<PacketModel>();
+    packet->number = view.number;
+    packet->timestamp = dateTimeFromUs(view.timestampUs);
+    packet->length = view.originalLength;
+    packet->protocol = protocolName(view);
+    packet->srcPort = view.srcPort;
+    packet->dstPort = view.dstPort;
+    packet->rawData = QByteArray::fromRawData(reinterpret_cast<const char *>(view.data),
+                                              static_cast<int>(view.capturedLength));
+    if (view.ipVersion != 0) {
+        packet->srcIP = addressName(view, view.srcAddress());
+        packet->dstIP = addressName(view, view.dstAddress());
+    }
+    packet->hasError = view.truncated;
+    if (view.truncated) {
+        packet->errorInfo = QStringLiteral("Truncated headers");
+    }
+    return packet;
+}
+
+const QString &CaptureReplay::addressName(const PacketView &view, const uchar *address) {
+    if (view.ipVersion == 4) {
+        const quint32 key = (static_cast<quint32>(address[0]) << 24) |
+                            (static_cast<quint32>(address[1]) << 16) |
+                            (static_cast<quint32>(address[2]) << 8) | address[3];
+        auto it = m_ipv4Names.find(key);
+        if (it == m_ipv4Names.end()) {
+            if (m_ipv4Names.size() >= MaxCachedAddresses) m_ipv4Names.clear();
+            it = m_ipv4Names.insert(key, QHostAddress(key).toString());
+        }
+        return it.value();
+    }
+
+    const QPair<quint64, quint64> key(readBE64(address), readBE64(address + 8));
+    auto it = m_ipv6Names.find(key);
+    if (it == m_ipv6Names.end()) {
+        if (m_ipv6Names.size() >= MaxCachedAddresses) m_ipv6Names.clear();
+        it = m_ipv6Names.insert(key, QHostAddress(address).toString());
+    }
+    return it.value();
+}
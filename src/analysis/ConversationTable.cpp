@@ -0,0 +1,156 @@
+#include "analysis/ConversationTable.h"
+
+const quint32 ConversationTable::InvalidSlot;
+
+ConversationTable::ConversationTable()
+    : m_lruHead(InvalidSlot)
+    , m_lruTail(InvalidSlot)
+    , m_wheel(WheelSize, InvalidSlot)
+    , m_wheelCursor(-1)
+{
+}
+
+void ConversationTable::clear() {
+    m_index.clear();
+    m_hot.clear();
+    m_cold.clear();
+    m_freeSlots.clear();
+    m_lruHead = m_lruTail = InvalidSlot;
+    m_wheel.fill(InvalidSlot);
+    m_wheelCursor = -1;
+}
+
+quint32 ConversationTable::insert(const FlowKey &key, const Conversation &conv, qint64 expirySecs) {
+    quint32 slot;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+        m_hot[slot] = HotSlot();
+    } else {
+        slot = static_cast<quint32>(m_hot.size());
+        m_hot.append(HotSlot());
+        m_cold.append(ColdSlot());
+    }
+
+    m_cold[slot].key = key;
+    m_cold[slot].used = true;
+    replace(slot, conv);
+    m_hot[slot].expirySecs = expirySecs;
+    m_index.insert(key, slot);
+    lruAppend(slot);
+    wheelInsert(slot);
+    return slot;
+}
+
+void ConversationTable::remove(quint32 slot) {
+    lruUnlink(slot);
+    wheelUnlink(slot);
+    m_index.remove(m_cold.at(slot).key);
+    m_cold[slot] = ColdSlot(); // Release strings and packet lists now
+    m_freeSlots.append(slot);
+}
+
+Conversation ConversationTable::conversation(quint32 slot) const {
+    Conversation conv;
+    assemble(slot, &conv);
+    return conv;
+}
+
+void ConversationTable::assemble(quint32 slot, Conversation *conv) const {
+    const Counters &c = m_hot.at(slot).counters;
+    *conv = m_cold.at(slot).conv;
+    conv->packetsAtoB = c.packetsAtoB;
+    conv->packetsBtoA = c.packetsBtoA;
+    conv->bytesAtoB = c.bytesAtoB;
+    conv->bytesBtoA = c.bytesBtoA;
+    conv->endTimeUs = c.endTimeUs;
+    conv->duration = (c.endTimeUs - conv->startTimeUs) / 1000000.0;
+}
+
+void ConversationTable::replace(quint32 slot, const Conversation &conv) {
+    Counters &c = m_hot[slot].counters;
+    c.packetsAtoB = conv.packetsAtoB;
+    c.packetsBtoA = conv.packetsBtoA;
+    c.bytesAtoB = conv.bytesAtoB;
+    c.bytesBtoA = conv.bytesBtoA;
+    c.endTimeUs = conv.endTimeUs;
+    m_cold[slot].conv = conv;
+}
+
+void ConversationTable::touch(quint32 slot, qint64 expirySecs) {
+    if (slot != m_lruTail) {
+        lruUnlink(slot);
+        lruAppend(slot);
+    }
+    if (m_hot.at(slot).expirySecs != expirySecs) {
+        wheelUnlink(slot);
+        m_hot[slot].expirySecs = expirySecs;
+        wheelInsert(slot);
+    }
+}
+
+QList<quint32> ConversationTable::collectExpired(qint64 nowSecs) {
+    QList<quint32> expired;
+    if (m_wheelCursor < 0) {
+        m_wheelCursor = nowSecs;
+        return expired;
+    }
+    if (nowSecs <= m_wheelCursor) {
+        return expired;
+    }
+
+    // Visit every bucket the clock passed over (each at most once)
+    qint64 from = m_wheelCursor + 1;
+    if (nowSecs - from >= WheelSize) {
+        from = nowSecs - WheelSize + 1;
+    }
+    for (qint64 tick = from; tick <= nowSecs; ++tick) {
+        quint32 slot = m_wheel.at(wheelBucket(tick));
+        while (slot != InvalidSlot) {
+            const HotSlot &s = m_hot.at(slot);
+            if (s.expirySecs <= nowSecs) {
+                expired.append(slot);
+            }
+            slot = s.wheelNext;
+        }
+    }
+
+    m_wheelCursor = nowSecs;
+    return expired;
+}
+
+void ConversationTable::lruUnlink(quint32 slot) {
+    HotSlot &s = m_hot[slot];
+    if (s.lruPrev != InvalidSlot) m_hot[s.lruPrev].lruNext = s.lruNext; else m_lruHead = s.lruNext;
+    if (s.lruNext != InvalidSlot) m_hot[s.lruNext].lruPrev = s.lruPrev; else m_lruTail = s.lruPrev;
+    s.lruPrev = s.lruNext = InvalidSlot;
+}
+
+void ConversationTable::lruAppend(quint32 slot) {
+    HotSlot &s = m_hot[slot];
+    s.lruPrev = m_lruTail;
+    s.lruNext = InvalidSlot;
+    if (m_lruTail != InvalidSlot) m_hot[m_lruTail].lruNext = slot; else m_lruHead = slot;
+    m_lruTail = slot;
+}
+
+int ConversationTable::wheelBucket(qint64 secs) {
+    const qint64 bucket = secs % WheelSize;
+    return static_cast<int>(bucket < 0 ? bucket + WheelSize : bucket);
+}
+
+void ConversationTable::wheelUnlink(quint32 slot) {
+    HotSlot &s = m_hot[slot];
+    const int bucket = wheelBucket(s.expirySecs);
+    if (s.wheelPrev != InvalidSlot) m_hot[s.wheelPrev].wheelNext = s.wheelNext; else m_wheel[bucket] = s.wheelNext;
+    if (s.wheelNext != InvalidSlot) m_hot[s.wheelNext].wheelPrev = s.wheelPrev;
+    s.wheelPrev = s.wheelNext = InvalidSlot;
+}
+
+void ConversationTable::wheelInsert(quint32 slot) {
+    HotSlot &s = m_hot[slot];
+    const int bucket = wheelBucket(s.expirySecs);
+    s.wheelPrev = InvalidSlot;
+    s.wheelNext = m_wheel.at(bucket);
+    if (s.wheelNext != InvalidSlot) m_hot[s.wheelNext].wheelPrev = slot;
+    m_wheel[bucket] = slot;
+}
@@ -1,19 +1,204 @@
 #include "analysis/ConversationTracker.h"
+#include "analysis/ConversationTable.h"
+#include "analysis/ProtocolClassifier.h"
+#include "analysis/StreamReassembler.h"
+#include "analysis/StreamTable.h"
+#include "analysis/StreamSummary.h"
+#include "analysis/SymbolTable.h"
+#include "analysis/TcpAnalyzer.h"
+#include "analysis/TcpHeader.h"
 #include <QFile>
 #include <QDataStream>
+#include <QVector>
 #include <QMutexLocker>
+#include <QSet>
+#include <QTimer>
 #include <algorithm>
 
+namespace {
+
+// Conversations tracked per shard for the by-bytes ranking (Space-Saving counters)
+const int ConversationByteRankCapacity = 1024;
+
+// Payload-carrying packets per conversation direction offered to the protocol classifier
+const quint8 MaxInspectedPayloads = 4;
+
+PacketNumberList mergePacketNumbers(const PacketNumberList &a, const PacketNumberList &b) {
+    PacketNumberList merged;
+    auto ia = a.begin();
+    auto ib = b.begin();
+    while (ia != a.end() || ib != b.end()) {
+        if (ib == b.end() || (ia != a.end() && *ia <= *ib)) {
+            merged.append(*ia);
+            ++ia;
+        } else {
+            merged.append(*ib);
+            ++ib;
+        }
+    }
+    merged.squeeze();
+    return merged;
+}
+
+// Whether a partition's record began first; an untimed start never does
+bool earlierStart(qint64 fromUs, qint64 intoUs) {
+    return fromUs != InvalidTimestamp && (intoUs == InvalidTimestamp || fromUs < intoUs);
+}
+
+// Swap the A and B sides so that A is the high endpoint exactly when aIsHigh
+void orientConversation(Conversation &conv, bool aIsHigh) {
+    if (conv.aIsHighEndpoint == aIsHigh) return;
+    std::swap(conv.addressA, conv.addressB);
+    std::swap(conv.portA, conv.portB);
+    std::swap(conv.packetsAtoB, conv.packetsBtoA);
+    std::swap(conv.bytesAtoB, conv.bytesBtoA);
+    conv.aIsHighEndpoint = aIsHigh;
+}
+
+void orientStream(TcpStream &stream, bool clientIsHigh) {
+    if (stream.clientIsHighEndpoint == clientIsHigh) return;
+    std::swap(stream.clientAddress, stream.serverAddress);
+    std::swap(stream.clientPort, stream.serverPort);
+    std::swap(stream.clientData, stream.serverData);
+    std::swap(stream.clientInitSeq, stream.serverInitSeq);
+    std::swap(stream.clientNextSeq, stream.serverNextSeq);
+    std::swap(stream.clientGaps, stream.serverGaps);
+    std::swap(stream.clientPackets, stream.serverPackets);
+    std::swap(stream.clientBytes, stream.serverBytes);
+    std::swap(stream.metrics.client, stream.metrics.server);
+    stream.clientIsHighEndpoint = clientIsHigh;
+}
+
+} // namespace
+
+/**
+ * @brief Signals produced while ingesting one packet
+ *
+ * Collected under the shard lock and emitted once the lock is released.
+ */
+struct ConversationTracker::PacketEvents {
+    QString conversationId;
+    bool conversationAdded;
+    bool conversationCompleted;
+    bool hasStream;
+    quint32 streamIndex;
+    bool streamCreated;
+    bool streamComplete;
+
+    PacketEvents() : conversationAdded(false), conversationCompleted(false), hasStream(false),
+                     streamIndex(0), streamCreated(false), streamComplete(false) {}
+};
+
+/**
+ * @brief Lifecycle signals of several packets, emitted together
+ *
+ * Used by batch ingest and, per shard, by coalesced notifications so that
+ * fewer signals are emitted without dropping any of these events.
+ */
+struct ConversationTracker::LifecycleEvents {
+    QStringList addedConversations;
+    QList<quint32> createdStreams;
+    QSet<QString> completedConversations;         // Reported by every packet after the close
+    QSet<quint32> completedStreams;
+
+    void record(const PacketEvents &events) {
+        if (events.conversationAdded) addedConversations.append(events.conversationId);
+        if (events.conversationCompleted) completedConversations.insert(events.conversationId);
+        if (events.hasStream) {
+            if (events.streamCreated) createdStreams.append(events.streamIndex);
+            if (events.streamComplete) completedStreams.insert(events.streamIndex);
+        }
+    }
+
+    void take(LifecycleEvents &other) {
+        addedConversations.append(other.addedConversations);
+        createdStreams.append(other.createdStreams);
+        completedConversations.unite(other.completedConversations);
+        completedStreams.unite(other.completedStreams);
+        other.clear();
+    }
+
+    bool isEmpty() const {
+        return addedConversations.isEmpty() && createdStreams.isEmpty() &&
+               completedConversations.isEmpty() && completedStreams.isEmpty();
+    }
+
+    void clear() {
+        addedConversations.clear();
+        createdStreams.clear();
+        completedConversations.clear();
+        completedStreams.clear();
+    }
+};
+
+/**
+ * @brief One independent partition of the tracker state
+ *
+ * Flows are routed to shards by their symmetric endpoint hash, so both
+ * directions of a conversation always land in the same shard. Stream
+ * indices are allocated as (local index * shard count + shard index) so a
+ * stream can be located from its index alone.
+ */
+struct alignas(64) ConversationTracker::Shard {
+    mutable QMutex mutex;
+    ConversationTable conversations;              // LRU order + expiry wheel
+    QHash<FlowKey, quint32> tcpStreamMap;         // Key: flow key, Value: stream index
+    StreamTable streams;                          // Streams and their reassembly state
+
+    // Conversation rankings for top-K queries
+    StreamSummary<FlowKey> packetRank;            // Exact packet counts
+    StreamSummary<FlowKey> byteRank;              // Bounded heavy hitters by bytes
+
+    // Changes not yet published (coalesced notifications only)
+    QSet<FlowKey> dirtyConversations;
+    QSet<quint32> dirtyStreams;
+    LifecycleEvents lifecycle;
+
+    SymbolCache protocolIds;                      // Protocol names seen by this shard
+
+    int index;
+    quint32 nextLocalStreamIndex;
+    quint64 totalPackets;
+    quint64 totalBytes;
+    qint64 clockSecs;                             // Newest packet time seen, -1 = none
+    qint64 lastTimeUs;                            // Newest valid packet time
+
+    Shard(int idx, SymbolTable *protocols)
+        : byteRank(ConversationByteRankCapacity), protocolIds(protocols), index(idx),
+          nextLocalStreamIndex(0), totalPackets(0), totalBytes(0),
+          clockSecs(-1), lastTimeUs(InvalidTimestamp) {}
+
+    void clear() {
+        conversations.clear();
+        tcpStreamMap.clear();
+        streams.clear();
+        packetRank.clear();
+        byteRank.clear();
+        dirtyConversations.clear();
+        dirtyStreams.clear();
+        lifecycle.clear();
+        protocolIds.clear();
+        nextLocalStreamIndex = 0;
+        totalPackets = 0;
+        totalBytes = 0;
+        clockSecs = -1;
+        lastTimeUs = InvalidTimestamp;
+    }
+};
+
 ConversationTracker::ConversationTracker(QObject *parent)
     : QObject(parent)
-    , m_nextStreamIndex(0)
     , m_maxConversations(100000)
     , m_conversationTimeout(3600)
     , m_enableStreamReassembly(true)
     , m_maxStreamSize(10 * 1024 * 1024) // 10 MB default
-    , m_totalPackets(0)
-    , m_totalBytes(0)
+    , m_lockFreeIngest(false)
+    , m_tcpProtocolId(static_cast<quint16>(m_protocolNames.acquire(QStringLiteral("TCP"))))
+    , m_notifyTimer(new QTimer(this))
+    , m_notifyIntervalMs(0)
 {
+    m_shards.append(std::make_shared<Shard>(0, &m_protocolNames));
+    connect(m_notifyTimer, &QTimer::timeout, this, &ConversationTracker::publishPendingUpdates);
 }
 
 ConversationTracker::~ConversationTracker() {
@@ -23,61 +208,483 @@ ConversationTracker::~ConversationTracker() {
 void ConversationTracker::addPacket(const std::shared_ptr<PacketModel> &packet) {
     if (!packet) return;
 
-    QMutexLocker locker(&m_mutex);
+    // Build the binary flow key; the textual ID is only made for new conversations
+    bool reversed = false;
+    FlowKey key = FlowKey::fromAddresses(0, packet->srcIP, packet->srcPort,
+                                         packet->dstIP, packet->dstPort, &reversed);
+
+    PacketEvents events;
+    {
+        Shard &shard = *m_shards.at(shardOf(key));
+        QMutexLocker locker(m_lockFreeIngest ? nullptr : &shard.mutex);
+        ingestPacket(shard, key, reversed, packet, packetTimestampUs(*packet), events);
+    }
+
+    // Coalesced mode: the change is published by publishPendingUpdates()
+    if (m_notifyIntervalMs > 0) return;
+
+    if (events.conversationAdded) {
+        emit conversationAdded(events.conversationId);
+    } else {
+        emit conversationUpdated(events.conversationId);
+    }
+    if (events.conversationCompleted) {
+        emit conversationCompleted(events.conversationId);
+    }
+    if (events.hasStream) {
+        if (events.streamCreated) {
+            emit tcpStreamCreated(events.streamIndex);
+        }
+        emit tcpStreamUpdated(events.streamIndex);
+        if (events.streamComplete) {
+            emit tcpStreamComplete(events.streamIndex);
+        }
+    }
+    emit statisticsUpdated();
+}
+
+void ConversationTracker::addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                                     const QVector<qint64> &timestampsUs) {
+    if (packets.isEmpty()) return;
+
+    struct Routed {
+        FlowKey key;
+        bool reversed;
+        int packetIndex;
+    };
+
+    // Keys are built outside any lock, then each shard is locked once
+    const int shardCount = m_shards.size();
+    QVector<QVector<Routed>> routed(shardCount);
+    for (int i = 0; i < packets.size(); ++i) {
+        const auto &packet = packets.at(i);
+        if (!packet) continue;
+        Routed entry;
+        entry.key = FlowKey::fromAddresses(0, packet->srcIP, packet->srcPort,
+                                           packet->dstIP, packet->dstPort, &entry.reversed);
+        entry.packetIndex = i;
+        routed[shardCount == 1 ? 0 : shardOf(entry.key)].append(entry);
+    }
+
+    // Signals are collected under the shard locks and emitted once the batch
+    // is in; in coalesced mode publishPendingUpdates() reports the changes
+    const bool notify = m_notifyIntervalMs == 0;
+    QSet<QString> updatedConversations;
+    QSet<quint32> updatedStreams;
+    LifecycleEvents lifecycle;
+
+    for (int s = 0; s < shardCount; ++s) {
+        const QVector<Routed> &entries = routed.at(s);
+        if (entries.isEmpty()) continue;
+
+        Shard &shard = *m_shards.at(s);
+        QMutexLocker locker(m_lockFreeIngest ? nullptr : &shard.mutex);
+        for (const Routed &entry : entries) {
+            PacketEvents events;
+            const auto &packet = packets.at(entry.packetIndex);
+            ingestPacket(shard, entry.key, entry.reversed, packet,
+                         batchTimestampUs(*packet, timestampsUs, entry.packetIndex), events);
+            if (!notify) continue;
+
+            updatedConversations.insert(events.conversationId);
+            if (events.hasStream) {
+                updatedStreams.insert(events.streamIndex);
+            }
+            lifecycle.record(events);
+        }
+    }
+
+    if (shardCount > 1) {
+        cleanupOldConversations();
+    }
+
+    if (!notify) return;
+
+    emitBatch(lifecycle, updatedConversations.values(), updatedStreams.values());
+}
+
+void ConversationTracker::emitBatch(const LifecycleEvents &lifecycle,
+                                    const QStringList &conversationIds,
+                                    const QList<quint32> &streamIndices) {
+    for (const QString &conversationId : lifecycle.addedConversations) {
+        emit conversationAdded(conversationId);
+    }
+    for (quint32 streamIndex : lifecycle.createdStreams) {
+        emit tcpStreamCreated(streamIndex);
+    }
+    emit conversationsBatchUpdated(conversationIds, streamIndices);
+    for (const QString &conversationId : lifecycle.completedConversations) {
+        emit conversationCompleted(conversationId);
+    }
+    for (quint32 streamIndex : lifecycle.completedStreams) {
+        emit tcpStreamComplete(streamIndex);
+    }
+    emit statisticsUpdated();
+}
+
+void ConversationTracker::ingestPacket(Shard &shard, FlowKey key, bool reversed,
+                                       const std::shared_ptr<PacketModel> &packet,
+                                       qint64 packetUs, PacketEvents &events) {
+    key.protocol = static_cast<quint16>(shard.protocolIds.intern(packet->protocol).id);
+    // A packet without a valid capture time takes the shard's newest one;
+    // before the first timed packet it is not placed in time
+    const qint64 timeUs = packetUs != InvalidTimestamp ? packetUs : shard.lastTimeUs;
+    shard.lastTimeUs = qMax(shard.lastTimeUs, timeUs);
+
+    // Expiry runs on packet time so offline captures age out like live ones
+    const qint64 nowSecs = timeUs != InvalidTimestamp ? timestampMs(timeUs) / 1000 : shard.clockSecs;
+    if (nowSecs > shard.clockSecs) {
+        shard.clockSecs = nowSecs;
+        expireConversations(shard, nowSecs);
+    }
+    const qint64 expirySecs = nowSecs + qMax(m_conversationTimeout.load(), 0);
 
-    // Generate conversation ID
-    QString convId = getConversationId(packet);
-    if (convId.isEmpty()) return;
+    // Decode the TCP header once; every TCP helper reads from this view
+    TcpHeader tcp;
+    if (key.protocol == m_tcpProtocolId) {
+        tcp = TcpHeader::fromPacket(*packet);
+    }
 
     // Update or create conversation
-    if (m_conversations.contains(convId)) {
-        updateConversation(convId, packet);
-        emit conversationUpdated(convId);
+    const quint32 slot = shard.conversations.find(key);
+    if (slot != ConversationTable::InvalidSlot) {
+        updateConversation(shard.conversations, slot, reversed, packet, timeUs, tcp, events);
+        events.conversationId = shard.conversations.details(slot).id;
+        shard.conversations.touch(slot, expirySecs);
     } else {
         // Create new conversation
         Conversation conv;
-        conv.id = convId;
+        conv.id = getConversationId(packet);
         conv.protocol = packet->protocol;
         conv.addressA = packet->srcIP;
         conv.portA = packet->srcPort;
         conv.addressB = packet->dstIP;
         conv.portB = packet->dstPort;
-        conv.startTime = packet->timestamp;
-        conv.endTime = packet->timestamp;
+        conv.aIsHighEndpoint = reversed;
+        conv.startTimeUs = timeUs;
+        conv.endTimeUs = timeUs;
         conv.firstPacketNum = packet->number;
         conv.lastPacketNum = packet->number;
         conv.packetsAtoB = 1;
         conv.bytesAtoB = packet->length;
         conv.packetNumbers.append(packet->number);
+        if (tcp.valid) {
+            updateTcpState(conv, packet, tcp, events);
+        }
 
-        m_conversations.insert(convId, conv);
-        emit conversationAdded(convId);
+        events.conversationId = conv.id;
+        events.conversationAdded = true;
+        const quint32 inserted = shard.conversations.insert(key, conv, expirySecs);
+        classifyConversation(shard.conversations, inserted, true, packet, tcp);
 
         // Enforce conversation limit
-        if (m_conversations.size() > static_cast<int>(m_maxConversations)) {
-            enforceConversationLimit();
+        if (static_cast<quint64>(shard.conversations.size()) > shardConversationLimit()) {
+            enforceConversationLimit(shard);
         }
     }
 
     // Handle TCP streams
-    if (packet->protocol == "TCP" && m_enableStreamReassembly) {
-        processTcpPacket(packet);
+    if (tcp.valid && m_enableStreamReassembly) {
+        processTcpPacket(shard, key, reversed, events.conversationId, packet, timeUs, tcp, events);
     }
 
+    shard.packetRank.increment(key);
+    shard.byteRank.add(key, packet->length);
+
     // Update statistics
-    m_totalPackets++;
-    m_totalBytes += packet->length;
-    emit statisticsUpdated();
+    shard.totalPackets++;
+    shard.totalBytes += packet->length;
+
+    if (m_notifyIntervalMs > 0) {
+        shard.dirtyConversations.insert(key);
+        if (events.hasStream) {
+            shard.dirtyStreams.insert(events.streamIndex);
+        }
+        shard.lifecycle.record(events);
+    }
+}
+
+void ConversationTracker::publishPendingUpdates() {
+    QStringList conversationIds;
+    QList<quint32> streamIndices;
+    LifecycleEvents lifecycle;
+
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        for (const FlowKey &key : shard->dirtyConversations) {
+            const quint32 slot = shard->conversations.find(key);
+            if (slot != ConversationTable::InvalidSlot) {
+                conversationIds.append(shard->conversations.details(slot).id);
+            }
+        }
+        for (quint32 streamIdx : shard->dirtyStreams) {
+            if (shard->streams.contains(streamIdx)) {
+                streamIndices.append(streamIdx);
+            }
+        }
+        shard->dirtyConversations.clear();
+        shard->dirtyStreams.clear();
+        lifecycle.take(shard->lifecycle);
+    }
+
+    if (conversationIds.isEmpty() && streamIndices.isEmpty() && lifecycle.isEmpty()) return;
+
+    // Emitted from the timer's thread, outside all shard locks
+    emitBatch(lifecycle, conversationIds, streamIndices);
 }
 
 void ConversationTracker::clear() {
-    QMutexLocker locker(&m_mutex);
-    m_conversations.clear();
-    m_tcpStreams.clear();
-    m_tcpStreamMap.clear();
-    m_nextStreamIndex = 0;
-    m_totalPackets = 0;
-    m_totalBytes = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->clear();
+    }
+}
+
+void ConversationTracker::merge(const ConversationTracker &other) {
+    if (&other == this) return;
+
+    for (const auto &otherShard : other.m_shards) {
+        // Copied out under the other shard's lock so the two trackers are never locked together
+        QList<QPair<FlowKey, Conversation>> conversations;
+        QHash<FlowKey, StreamTable::Record> streams;
+        quint64 packets = 0;
+        quint64 bytes = 0;
+        qint64 clockSecs = -1;
+        qint64 lastTimeUs = InvalidTimestamp;
+        {
+            QMutexLocker locker(&otherShard->mutex);
+            conversations.reserve(otherShard->conversations.size());
+            otherShard->conversations.forEachEntry([&conversations](const FlowKey &key,
+                                                                    const Conversation &conv) {
+                conversations.append(qMakePair(key, conv));
+            });
+            for (auto it = otherShard->tcpStreamMap.constBegin();
+                 it != otherShard->tcpStreamMap.constEnd(); ++it) {
+                if (const StreamTable::Record *record = otherShard->streams.find(it.value())) {
+                    streams.insert(it.key(), *record);
+                }
+            }
+            packets = otherShard->totalPackets;
+            bytes = otherShard->totalBytes;
+            clockSecs = otherShard->clockSecs;
+            lastTimeUs = otherShard->lastTimeUs;
+        }
+
+        // Traffic totals include conversations the other tracker already evicted
+        {
+            Shard &totals = *m_shards.at(otherShard->index % m_shards.size());
+            QMutexLocker locker(&totals.mutex);
+            totals.totalPackets += packets;
+            totals.totalBytes += bytes;
+            totals.clockSecs = qMax(totals.clockSecs, clockSecs);
+            totals.lastTimeUs = qMax(totals.lastTimeUs, lastTimeUs);
+        }
+
+        for (const auto &entry : conversations) {
+            Shard &shard = *m_shards.at(shardOf(entry.first));
+            QMutexLocker locker(&shard.mutex);
+            // Protocol IDs are per tracker, so the key is re-interned here
+            FlowKey key = entry.first;
+            key.protocol = static_cast<quint16>(shard.protocolIds.intern(entry.second.protocol).id);
+            mergeConversation(shard, key, entry.second);
+            auto streamIt = streams.constFind(entry.first);
+            if (streamIt != streams.constEnd()) {
+                mergeTcpStream(shard, key, streamIt.value().stream,
+                               streamIt.value().client, streamIt.value().server);
+            }
+            if (static_cast<quint64>(shard.conversations.size()) > shardConversationLimit()) {
+                enforceConversationLimit(shard);
+            }
+        }
+    }
+
+    if (m_notifyIntervalMs == 0) {
+        emit statisticsUpdated();
+    }
+}
+
+void ConversationTracker::mergeConversation(Shard &shard, const FlowKey &key,
+                                            const Conversation &from) {
+    const qint64 timeout = qMax(m_conversationTimeout.load(), 0);
+    const quint32 slot = shard.conversations.find(key);
+    if (slot == ConversationTable::InvalidSlot) {
+        shard.conversations.insert(key, from, timestampMs(from.endTimeUs) / 1000 + timeout);
+    } else {
+        Conversation conv = shard.conversations.conversation(slot);
+        const bool fromFirst = earlierStart(from.startTimeUs, conv.startTimeUs);
+        const bool aIsHigh = fromFirst ? from.aIsHighEndpoint : conv.aIsHighEndpoint;
+
+        Conversation other = from;
+        orientConversation(other, conv.aIsHighEndpoint);
+        conv.packetsAtoB += other.packetsAtoB;
+        conv.packetsBtoA += other.packetsBtoA;
+        conv.bytesAtoB += other.bytesAtoB;
+        conv.bytesBtoA += other.bytesBtoA;
+
+        if (fromFirst) {
+            conv.startTimeUs = other.startTimeUs;
+            conv.firstPacketNum = other.firstPacketNum;
+        }
+        if (other.endTimeUs > conv.endTimeUs) {
+            conv.endTimeUs = other.endTimeUs;
+            conv.lastPacketNum = other.lastPacketNum;
+        }
+        conv.duration = (conv.endTimeUs - conv.startTimeUs) / 1000000.0;
+        conv.packetNumbers = mergePacketNumbers(conv.packetNumbers, other.packetNumbers);
+
+        conv.hasSyn |= other.hasSyn;
+        conv.hasFin |= other.hasFin;
+        conv.hasRst |= other.hasRst;
+        if (other.synPacketNum != 0 && (conv.synPacketNum == 0 || other.synPacketNum < conv.synPacketNum)) {
+            conv.synPacketNum = other.synPacketNum;
+        }
+        conv.finPacketNum = qMax(conv.finPacketNum, other.finPacketNum);
+        conv.isTcpComplete = conv.hasSyn && (conv.hasFin || conv.hasRst);
+
+        if (conv.applicationProtocol.isEmpty()) {
+            conv.applicationProtocol = other.applicationProtocol;
+        }
+        for (auto it = other.metadata.constBegin(); it != other.metadata.constEnd(); ++it) {
+            if (!conv.metadata.contains(it.key())) {
+                conv.metadata.insert(it.key(), it.value());
+            }
+        }
+
+        orientConversation(conv, aIsHigh);
+        shard.conversations.replace(slot, conv);
+        shard.conversations.touch(slot, timestampMs(conv.endTimeUs) / 1000 + timeout);
+    }
+
+    shard.packetRank.add(key, from.packetsAtoB + from.packetsBtoA);
+    shard.byteRank.add(key, from.bytesAtoB + from.bytesBtoA);
+    if (m_notifyIntervalMs > 0) {
+        shard.dirtyConversations.insert(key);
+    }
+}
+
+void ConversationTracker::mergeTcpStream(Shard &shard, const FlowKey &key, const TcpStream &from,
+                                         const StreamReassembler &fromClient,
+                                         const StreamReassembler &fromServer) {
+    auto indexIt = shard.tcpStreamMap.constFind(key);
+    if (indexIt == shard.tcpStreamMap.constEnd()) {
+        TcpStream stream = from;
+        stream.streamIndex = shard.nextLocalStreamIndex++ * static_cast<quint32>(m_shards.size()) +
+                             static_cast<quint32>(shard.index);
+        // A private copy of the reassemblers; only the packet buffers stay shared
+        StreamTable::Record &record = shard.streams.insert(stream, m_maxStreamSize);
+        record.client = fromClient;
+        record.server = fromServer;
+        record.client.setMaxBytes(m_maxStreamSize);
+        record.server.setMaxBytes(m_maxStreamSize);
+        shard.tcpStreamMap.insert(key, stream.streamIndex);
+        if (m_notifyIntervalMs > 0) {
+            shard.dirtyStreams.insert(stream.streamIndex);
+        }
+        return;
+    }
+
+    StreamTable::Record *record = shard.streams.find(indexIt.value());
+    if (!record) return;
+    TcpStream &stream = record->stream;
+
+    // Bring the other side's view into this stream's client/server orientation
+    const bool fromFirst = earlierStart(from.startTimeUs, stream.startTimeUs);
+    const bool clientIsHigh = fromFirst ? from.clientIsHighEndpoint : stream.clientIsHighEndpoint;
+    TcpStream other = from;
+    const bool swapped = other.clientIsHighEndpoint != stream.clientIsHighEndpoint;
+    if (swapped) {
+        orientStream(other, stream.clientIsHighEndpoint);
+    }
+
+    stream.clientPackets += other.clientPackets;
+    stream.serverPackets += other.serverPackets;
+    stream.clientBytes += other.clientBytes;
+    stream.serverBytes += other.serverBytes;
+    stream.retransmissions += other.retransmissions;
+    stream.outOfOrder += other.outOfOrder;
+    stream.isComplete |= other.isComplete;
+    TcpAnalyzer::mergeMetrics(stream.metrics, stream.startTimeUs, other.metrics, other.startTimeUs);
+    if (fromFirst) {
+        stream.startTimeUs = other.startTimeUs;
+        stream.clientInitSeq = other.clientInitSeq;
+        stream.serverInitSeq = other.serverInitSeq;
+    }
+    stream.endTimeUs = qMax(stream.endTimeUs, other.endTimeUs);
+
+    const bool reassembled = !stream.clientData.isEmpty() || !stream.serverData.isEmpty() ||
+                             !other.clientData.isEmpty() || !other.serverData.isEmpty();
+    record->client.merge(swapped ? fromServer : fromClient);
+    record->server.merge(swapped ? fromClient : fromServer);
+    stream.clientNextSeq = record->client.nextSequence();
+    stream.serverNextSeq = record->server.nextSequence();
+    stream.clientGaps = record->client.gaps();
+    stream.serverGaps = record->server.gaps();
+    stream.hasGaps = record->client.hasGaps() || record->server.hasGaps();
+    if (reassembled) {
+        stream.clientData = record->client.data();
+        stream.serverData = record->server.data();
+    }
+
+    if (stream.clientIsHighEndpoint != clientIsHigh) {
+        orientStream(stream, clientIsHigh);
+        std::swap(record->client, record->server);
+    }
+    if (m_notifyIntervalMs > 0) {
+        shard.dirtyStreams.insert(stream.streamIndex);
+    }
+}
+
+void ConversationTracker::setShardCount(int count) {
+    count = qBound(1, count, 256);
+    clear();
+    m_shards.clear();
+    for (int i = 0; i < count; ++i) {
+        m_shards.append(std::make_shared<Shard>(i, &m_protocolNames));
+    }
+}
+
+int ConversationTracker::getShardCount() const {
+    return m_shards.size();
+}
+
+int ConversationTracker::getShardForPacket(const std::shared_ptr<PacketModel> &packet) const {
+    if (!packet) return 0;
+    return shardOf(FlowKey::fromAddresses(0, packet->srcIP, packet->srcPort,
+                                          packet->dstIP, packet->dstPort));
+}
+
+void ConversationTracker::setLockFreeIngest(bool enable) {
+    // The coalescing timer drains the shards while ingest runs, so it needs the locks
+    if (enable && m_notifyIntervalMs > 0) return;
+    m_lockFreeIngest = enable;
+}
+
+void ConversationTracker::setNotificationInterval(int intervalMs) {
+    if (intervalMs > 0 && m_lockFreeIngest) return;
+    m_notifyIntervalMs = qMax(0, intervalMs);
+    if (m_notifyIntervalMs > 0) {
+        m_notifyTimer->start(m_notifyIntervalMs);
+    } else {
+        m_notifyTimer->stop();
+        publishPendingUpdates();
+    }
+}
+
+int ConversationTracker::shardOf(const FlowKey &key) const {
+    const int count = m_shards.size();
+    if (count == 1) return 0;
+    // Multiply-shift instead of modulo
+    const quint64 h = key.endpointHash() & 0xFFFFFFFFULL;
+    return static_cast<int>((h * static_cast<quint64>(count)) >> 32);
+}
+
+int ConversationTracker::shardOfStream(quint32 streamIndex) const {
+    return static_cast<int>(streamIndex % static_cast<quint32>(m_shards.size()));
+}
+
+quint64 ConversationTracker::shardConversationLimit() const {
+    const quint64 count = static_cast<quint64>(m_shards.size());
+    return qMax<quint64>(1, (m_maxConversations + count - 1) / count);
 }
 
 void ConversationTracker::reset() {
@@ -101,73 +708,157 @@ QString ConversationTracker::normalizeConversationKey(const QString &addrA, quin
     }
 }
 
+bool ConversationTracker::parseConversationId(const QString &conversationId, QString *protocol,
+                                              FlowKey *key) const {
+    // Format: <proto>_<addrA>:<portA>_<addrB>:<portB>; parsed from the right
+    // since IPv6 addresses contain ':' and protocol names may contain '_'
+    const int sepB = conversationId.lastIndexOf(QLatin1Char('_'));
+    if (sepB <= 0) return false;
+    const int sepA = conversationId.lastIndexOf(QLatin1Char('_'), sepB - 1);
+    if (sepA <= 0) return false;
+
+    const QString endpointA = conversationId.mid(sepA + 1, sepB - sepA - 1);
+    const QString endpointB = conversationId.mid(sepB + 1);
+    const int colonA = endpointA.lastIndexOf(QLatin1Char(':'));
+    const int colonB = endpointB.lastIndexOf(QLatin1Char(':'));
+    if (colonA < 0 || colonB < 0) return false;
+
+    bool okA = false;
+    bool okB = false;
+    const quint16 portA = static_cast<quint16>(endpointA.mid(colonA + 1).toUInt(&okA));
+    const quint16 portB = static_cast<quint16>(endpointB.mid(colonB + 1).toUInt(&okB));
+    if (!okA || !okB) return false;
+
+    // The protocol id is shard-local, so it is resolved by the caller
+    *protocol = conversationId.left(sepA);
+    *key = FlowKey::fromAddresses(0, endpointA.left(colonA), portA,
+                                  endpointB.left(colonB), portB);
+    return true;
+}
+
 QString ConversationTracker::getConversationId(const std::shared_ptr<PacketModel> &packet) const {
     if (!packet) return QString();
     return generateConversationId(packet->protocol, packet->srcIP, packet->srcPort,
                                   packet->dstIP, packet->dstPort);
 }
 
-void ConversationTracker::updateConversation(const QString &convId,
-                                            const std::shared_ptr<PacketModel> &packet) {
-    if (!m_conversations.contains(convId)) return;
+bool ConversationTracker::resolveProtocol(const QString &protocol, FlowKey *key) const {
+    quint32 id = 0;
+    if (!m_protocolNames.lookup(protocol, &id)) return false;
+    key->protocol = static_cast<quint16>(id);
+    return true;
+}
 
-    Conversation &conv = m_conversations[convId];
+void ConversationTracker::updateConversation(ConversationTable &table, quint32 slot,
+                                            bool reversed,
+                                            const std::shared_ptr<PacketModel> &packet,
+                                            qint64 timeUs, const TcpHeader &tcp,
+                                            PacketEvents &events) {
+    ConversationTable::Counters &counters = table.counters(slot);
+    Conversation &conv = table.details(slot);
 
     // Determine direction
-    bool isAtoB = (packet->srcIP == conv.addressA && packet->srcPort == conv.portA);
+    bool isAtoB = (reversed == conv.aIsHighEndpoint);
 
     // Update statistics
     if (isAtoB) {
-        conv.packetsAtoB++;
-        conv.bytesAtoB += packet->length;
+        counters.packetsAtoB++;
+        counters.bytesAtoB += packet->length;
     } else {
-        conv.packetsBtoA++;
-        conv.bytesBtoA += packet->length;
+        counters.packetsBtoA++;
+        counters.bytesBtoA += packet->length;
     }
 
-    // Update timing
-    conv.endTime = packet->timestamp;
-    conv.duration = conv.startTime.msecsTo(conv.endTime) / 1000.0;
+    // Update timing; the duration is derived when the record is assembled
+    if (conv.startTimeUs == InvalidTimestamp) {
+        conv.startTimeUs = timeUs;               // First packets carried no time
+    }
+    counters.endTimeUs = timeUs;
     conv.lastPacketNum = packet->number;
     conv.packetNumbers.append(packet->number);
 
     // TCP-specific handling
-    if (packet->protocol == "TCP") {
-        updateTcpState(conv, packet);
+    if (tcp.valid) {
+        updateTcpState(conv, packet, tcp, events);
+    }
+
+    classifyConversation(table, slot, isAtoB, packet, tcp);
+}
+
+void ConversationTracker::classifyConversation(ConversationTable &table, quint32 slot,
+                                              bool isAtoB,
+                                              const std::shared_ptr<PacketModel> &packet,
+                                              const TcpHeader &tcp) {
+    Conversation &conv = table.details(slot);
+    // Counted per direction, so one side's payloads cannot use up the other's
+    // turns (a server banner arriving after several client segments)
+    quint8 &inspected = table.inspectedPayloads(slot, isAtoB);
+    quint8 &peerInspected = table.inspectedPayloads(slot, !isAtoB);
+
+    // Payload signatures first; a match replaces the port guess
+    if (inspected < MaxInspectedPayloads) {
+        int offset = tcp.payloadOffset;
+        quint32 length = tcp.payloadLength;
+        bool udp = false;
+        if (!tcp.valid) {
+            const UdpHeader header = UdpHeader::fromPacket(*packet);
+            offset = header.payloadOffset;
+            length = header.payloadLength;
+            udp = header.valid;
+            if (!udp) {
+                // Neither TCP nor UDP: nothing to inspect
+                inspected = peerInspected = MaxInspectedPayloads;
+            }
+        }
+
+        if (offset >= 0 && length > 0) {
+            ++inspected;
+            const int available = qMin(static_cast<int>(length), packet->rawData.size() - offset);
+            const ProtocolClassifier::Match match = ProtocolClassifier::standard().classify(
+                reinterpret_cast<const uchar *>(packet->rawData.constData()) + offset,
+                available, udp);
+            if (match.isValid()) {
+                inspected = peerInspected = MaxInspectedPayloads;
+                // HTTPS from the port is the more specific name for TLS
+                if (match.protocol != QLatin1String("TLS") ||
+                    conv.applicationProtocol != QLatin1String("HTTPS")) {
+                    conv.applicationProtocol = match.protocol;
+                }
+                if (!match.serverName.isEmpty()) {
+                    conv.metadata.insert(QStringLiteral("serverName"), match.serverName);
+                }
+            }
+        }
     }
 
-    // Detect application protocol
     if (conv.applicationProtocol.isEmpty()) {
         detectApplicationProtocol(conv, packet);
     }
 }
 
 void ConversationTracker::updateTcpState(Conversation &conv,
-                                        const std::shared_ptr<PacketModel> &packet) {
-    // Check TCP flags from custom fields
-    if (packet->customFields.contains("tcp.flags.syn") &&
-        packet->customFields["tcp.flags.syn"].toBool()) {
+                                        const std::shared_ptr<PacketModel> &packet,
+                                        const TcpHeader &tcp, PacketEvents &events) {
+    if (tcp.has(TcpHeader::Syn)) {
         conv.hasSyn = true;
         if (conv.synPacketNum == 0) {
             conv.synPacketNum = packet->number;
         }
     }
 
-    if (packet->customFields.contains("tcp.flags.fin") &&
-        packet->customFields["tcp.flags.fin"].toBool()) {
+    if (tcp.has(TcpHeader::Fin)) {
         conv.hasFin = true;
         conv.finPacketNum = packet->number;
     }
 
-    if (packet->customFields.contains("tcp.flags.rst") &&
-        packet->customFields["tcp.flags.rst"].toBool()) {
+    if (tcp.has(TcpHeader::Rst)) {
         conv.hasRst = true;
     }
 
     // Check if connection is complete
     if (conv.hasSyn && (conv.hasFin || conv.hasRst)) {
         conv.isTcpComplete = true;
-        emit conversationCompleted(conv.id);
+        events.conversationCompleted = true;
     }
 }
 
@@ -196,90 +887,282 @@ void ConversationTracker::detectApplicationProtocol(Conversation &conv,
 }
 
 QList<Conversation> ConversationTracker::getAllConversations() const {
-    QMutexLocker locker(&m_mutex);
-    return m_conversations.values();
+    QList<Conversation> result;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->conversations.forEach([&result](const Conversation &conv) {
+            result.append(conv);
+        });
+    }
+    return result;
 }
 
-QList<Conversation> ConversationTracker::getConversationsByProtocol(const QString &protocol) const {
-    QMutexLocker locker(&m_mutex);
+void ConversationTracker::visitConversations(const ConversationVisitor &visitor) const {
+    Conversation conv;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        const ConversationTable &table = shard->conversations;
+        for (quint32 slot = 0; slot < table.slotCount(); ++slot) {
+            if (!table.isUsed(slot)) continue;
+            table.assemble(slot, &conv);
+            if (!visitor(conv)) return;
+        }
+    }
+}
+
+void ConversationTracker::visitTcpStreams(const TcpStreamVisitor &visitor) const {
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        bool proceed = true;
+        shard->streams.forEach([&](const StreamTable::Record &record) {
+            if (proceed) {
+                proceed = visitor(record.stream);
+            }
+        });
+        if (!proceed) return;
+    }
+}
+
+QList<Conversation> ConversationTracker::getConversationPage(ConversationCursor *cursor,
+                                                            int count) const {
     QList<Conversation> result;
-    for (const auto &conv : m_conversations) {
-        if (conv.protocol == protocol) {
-            result.append(conv);
+    if (!cursor || cursor->atEnd() || count <= 0) return result;
+
+    while (cursor->shard < m_shards.size()) {
+        const Shard &shard = *m_shards.at(cursor->shard);
+        QMutexLocker locker(&shard.mutex);
+        const ConversationTable &table = shard.conversations;
+        while (cursor->slot < table.slotCount()) {
+            const quint32 slot = cursor->slot++;
+            if (!table.isUsed(slot)) continue;
+            result.append(table.conversation(slot));
+            if (result.size() == count) return result;
+        }
+        cursor->shard++;
+        cursor->slot = 0;
+    }
+    cursor->shard = -1;
+    return result;
+}
+
+QList<Conversation> ConversationTracker::getTopConversationsByPackets(int count) const {
+    return topConversations(count, false);
+}
+
+QList<Conversation> ConversationTracker::getTopConversationsByBytes(int count) const {
+    return topConversations(count, true);
+}
+
+QList<Conversation> ConversationTracker::topConversations(int count, bool byBytes) const {
+    // Each shard contributes its own top-K; only those candidates are merged
+    QList<QPair<quint64, Conversation>> candidates;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        const StreamSummary<FlowKey> &rank = byBytes ? shard->byteRank : shard->packetRank;
+        for (const auto &entry : rank.top(count)) {
+            const quint32 slot = shard->conversations.find(entry.first);
+            if (slot != ConversationTable::InvalidSlot) {
+                candidates.append(qMakePair(entry.second, shard->conversations.conversation(slot)));
+            }
         }
     }
+
+    if (m_shards.size() > 1) {
+        std::stable_sort(candidates.begin(), candidates.end(),
+                         [](const QPair<quint64, Conversation> &a,
+                            const QPair<quint64, Conversation> &b) {
+                             return a.first > b.first;
+                         });
+    }
+
+    QList<Conversation> result;
+    for (int i = 0; i < qMin(count, candidates.size()); ++i) {
+        result.append(candidates.at(i).second);
+    }
+    return result;
+}
+
+QList<Conversation> ConversationTracker::getActiveConversations(const QDateTime &since) const {
+    const qint64 sinceUs = timestampUs(since);
+    QList<Conversation> result;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->conversations.forEach([&](const Conversation &conv) {
+            if (conv.endTimeUs >= sinceUs) {
+                result.append(conv);
+            }
+        });
+    }
+    return result;
+}
+
+QList<Conversation> ConversationTracker::getConversationsByProtocol(const QString &protocol) const {
+    QList<Conversation> result;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->conversations.forEach([&](const Conversation &conv) {
+            if (conv.protocol == protocol) {
+                result.append(conv);
+            }
+        });
+    }
     return result;
 }
 
 Conversation ConversationTracker::getConversation(const QString &conversationId) const {
-    QMutexLocker locker(&m_mutex);
-    return m_conversations.value(conversationId);
+    QString protocol;
+    FlowKey key;
+    if (!parseConversationId(conversationId, &protocol, &key)) return Conversation();
+
+    const Shard &shard = *m_shards.at(shardOf(key));
+    QMutexLocker locker(&shard.mutex);
+    if (!resolveProtocol(protocol, &key)) return Conversation();
+    const quint32 slot = shard.conversations.find(key);
+    return slot != ConversationTable::InvalidSlot ? shard.conversations.conversation(slot) : Conversation();
+}
+
+bool ConversationTracker::visitConversationPackets(const QString &conversationId,
+                                                   const std::function<bool(quint64)> &visitor) const {
+    QString protocol;
+    FlowKey key;
+    if (!parseConversationId(conversationId, &protocol, &key)) return false;
+
+    const Shard &shard = *m_shards.at(shardOf(key));
+    QMutexLocker locker(&shard.mutex);
+    if (!resolveProtocol(protocol, &key)) return false;
+    const quint32 slot = shard.conversations.find(key);
+    if (slot == ConversationTable::InvalidSlot) return false;
+
+    // Decoded in place; nothing is materialized
+    for (quint64 number : shard.conversations.details(slot).packetNumbers) {
+        if (!visitor(number)) break;
+    }
+    return true;
 }
 
 QList<quint64> ConversationTracker::getConversationPackets(const QString &conversationId) const {
-    QMutexLocker locker(&m_mutex);
-    if (m_conversations.contains(conversationId)) {
-        return m_conversations[conversationId].packetNumbers;
+    return getConversationPackets(conversationId, 0, -1);
+}
+
+QList<quint64> ConversationTracker::getConversationPackets(const QString &conversationId,
+                                                           int offset, int count) const {
+    QString protocol;
+    FlowKey key;
+    if (!parseConversationId(conversationId, &protocol, &key)) return QList<quint64>();
+
+    const Shard &shard = *m_shards.at(shardOf(key));
+    QMutexLocker locker(&shard.mutex);
+    if (!resolveProtocol(protocol, &key)) return QList<quint64>();
+    const quint32 slot = shard.conversations.find(key);
+    if (slot != ConversationTable::InvalidSlot) {
+        return shard.conversations.details(slot).packetNumbers.mid(offset, count);
     }
     return QList<quint64>();
 }
 
-void ConversationTracker::processTcpPacket(const std::shared_ptr<PacketModel> &packet) {
-    quint32 streamIdx = getOrCreateTcpStream(packet);
-    if (streamIdx == 0) return;
+void ConversationTracker::processTcpPacket(Shard &shard, const FlowKey &key, bool reversed,
+                                           const QString &convId,
+                                           const std::shared_ptr<PacketModel> &packet,
+                                           qint64 timeUs, const TcpHeader &tcp,
+                                           PacketEvents &events) {
+    quint32 streamIdx = getOrCreateTcpStream(shard, key, reversed, convId, packet, timeUs, events);
 
-    TcpStream &stream = m_tcpStreams[streamIdx];
-    addTcpSegment(stream, packet);
-    detectTcpFlags(stream, packet);
-    emit tcpStreamUpdated(streamIdx);
+    // Looked up after the insert, which may move the slab
+    StreamTable::Record &record = *shard.streams.find(streamIdx);
+    addTcpSegment(record.stream, record.client, record.server, record.analyzer,
+                  reversed == record.stream.clientIsHighEndpoint, packet, timeUs, tcp);
+    detectTcpFlags(record.stream, tcp, events);
+    events.hasStream = true;
+    events.streamIndex = streamIdx;
 }
 
-quint32 ConversationTracker::getOrCreateTcpStream(const std::shared_ptr<PacketModel> &packet) {
-    QString convId = getConversationId(packet);
-    
-    if (m_tcpStreamMap.contains(convId)) {
-        return m_tcpStreamMap[convId];
+quint32 ConversationTracker::getOrCreateTcpStream(Shard &shard, const FlowKey &key, bool reversed,
+                                                  const QString &convId,
+                                                  const std::shared_ptr<PacketModel> &packet,
+                                                  qint64 timeUs, PacketEvents &events) {
+    auto it = shard.tcpStreamMap.constFind(key);
+    if (it != shard.tcpStreamMap.constEnd()) {
+        return it.value();
     }
 
     // Create new stream
     TcpStream stream;
-    stream.streamIndex = m_nextStreamIndex++;
+    stream.streamIndex = shard.nextLocalStreamIndex++ * static_cast<quint32>(m_shards.size()) +
+                         static_cast<quint32>(shard.index);
     stream.conversationId = convId;
     stream.clientAddress = packet->srcIP;
     stream.clientPort = packet->srcPort;
     stream.serverAddress = packet->dstIP;
     stream.serverPort = packet->dstPort;
-    stream.startTime = packet->timestamp;
-
-    // Get initial sequence numbers from SYN
-    if (packet->customFields.contains("tcp.seq")) {
-        stream.clientInitSeq = packet->customFields["tcp.seq"].toUInt();
-        stream.clientNextSeq = stream.clientInitSeq + 1;
-    }
+    stream.clientIsHighEndpoint = reversed;
+    stream.startTimeUs = timeUs;
 
-    m_tcpStreams.insert(stream.streamIndex, stream);
-    m_tcpStreamMap.insert(convId, stream.streamIndex);
-    emit tcpStreamCreated(stream.streamIndex);
+    // Initial sequence numbers are taken from the SYNs in addTcpSegment()
+    shard.streams.insert(stream, m_maxStreamSize);
+    shard.tcpStreamMap.insert(key, stream.streamIndex);
+    events.streamCreated = true;
 
     return stream.streamIndex;
 }
 
-void ConversationTracker::addTcpSegment(TcpStream &stream,
-                                       const std::shared_ptr<PacketModel> &packet) {
-    bool isClientToServer = (packet->srcIP == stream.clientAddress &&
-                             packet->srcPort == stream.clientPort);
+void ConversationTracker::addTcpSegment(TcpStream &stream, StreamReassembler &client,
+                                       StreamReassembler &server, TcpAnalyzer &analyzer,
+                                       bool isClientToServer,
+                                       const std::shared_ptr<PacketModel> &packet,
+                                       qint64 timeUs, const TcpHeader &tcp) {
+    const quint32 seq = tcp.seq;
+    const quint32 payloadLen = tcp.payloadLength;
+    const bool hasSyn = tcp.has(TcpHeader::Syn);
 
-    quint32 seq = packet->customFields.value("tcp.seq", 0).toUInt();
-    quint32 payloadLen = packet->customFields.value("tcp.len", 0).toUInt();
+    // Retransmissions and reordering are judged from sequence numbers, which
+    // works whether or not the payload was captured; the timing needs a time
+    if (timeUs != InvalidTimestamp) {
+        if (stream.startTimeUs == InvalidTimestamp) {
+            stream.startTimeUs = timeUs;
+        }
+        analyzer.addSegment(stream, isClientToServer, timeUs, tcp);
+    }
+
+    StreamReassembler &reassembler = isClientToServer ? client : server;
+    quint32 &initSeq = isClientToServer ? stream.clientInitSeq : stream.serverInitSeq;
+    quint32 &nextSeq = isClientToServer ? stream.clientNextSeq : stream.serverNextSeq;
+
+    // SYN consumes one sequence number; payload starts at ISN + 1
+    if (hasSyn && !reassembler.isInitialized()) {
+        initSeq = seq;
+        reassembler.setInitialSequence(seq + 1);
+        nextSeq = reassembler.nextSequence();
+    }
 
     if (payloadLen == 0) return;
 
-    // Check for retransmission
-    if (isRetransmission(stream, seq, payloadLen, isClientToServer)) {
-        stream.retransmissions++;
+    // Picked up mid-stream: start at the first payload byte seen
+    if (!reassembler.isInitialized()) {
+        initSeq = seq;
+        reassembler.setInitialSequence(seq);
+    }
+
+    // Nothing new for the reassembled data
+    if (reassembler.isRetransmission(seq, payloadLen)) {
         return;
     }
 
+    if (tcp.payloadOffset >= 0) {
+        const StreamReassembler::SegmentResult result =
+            reassembler.addSegment(seq, packet->rawData, tcp.payloadOffset,
+                                   static_cast<int>(payloadLen));
+        if (result == StreamReassembler::Retransmission) {
+            // Duplicate of data already buffered behind a gap
+            return;
+        }
+
+        nextSeq = reassembler.nextSequence();
+        if (reassembler.hasGaps() || stream.hasGaps) {
+            (isClientToServer ? stream.clientGaps : stream.serverGaps) = reassembler.gaps();
+            stream.hasGaps = client.hasGaps() || server.hasGaps();
+        }
+    }
+
     // Update statistics
     if (isClientToServer) {
         stream.clientPackets++;
@@ -289,54 +1172,150 @@ void ConversationTracker::addTcpSegment(TcpStream &stream,
         stream.serverBytes += payloadLen;
     }
 
-    stream.endTime = packet->timestamp;
-}
-
-bool ConversationTracker::isRetransmission(const TcpStream &stream, quint32 seq, quint32 len,
-                                          bool clientToServer) const {
-    quint32 expectedSeq = clientToServer ? stream.clientNextSeq : stream.serverNextSeq;
-    return (seq + len) <= expectedSeq;
+    stream.endTimeUs = timeUs;
 }
 
-void ConversationTracker::detectTcpFlags(TcpStream &stream,
-                                        const std::shared_ptr<PacketModel> &packet) {
-    bool hasFin = packet->customFields.value("tcp.flags.fin", false).toBool();
-    bool hasRst = packet->customFields.value("tcp.flags.rst", false).toBool();
-
-    if (hasFin || hasRst) {
+void ConversationTracker::detectTcpFlags(TcpStream &stream, const TcpHeader &tcp,
+                                        PacketEvents &events) {
+    if (tcp.flags & (TcpHeader::Fin | TcpHeader::Rst)) {
         stream.isComplete = true;
-        emit tcpStreamComplete(stream.streamIndex);
+        events.streamComplete = true;
     }
 }
 
 QList<TcpStream> ConversationTracker::getAllTcpStreams() const {
-    QMutexLocker locker(&m_mutex);
-    return m_tcpStreams.values();
+    QList<TcpStream> result;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->streams.forEach([&](const StreamTable::Record &record) {
+            result.append(record.stream);
+        });
+    }
+    return result;
 }
 
 TcpStream ConversationTracker::getTcpStream(quint32 streamIndex) const {
-    QMutexLocker locker(&m_mutex);
-    return m_tcpStreams.value(streamIndex);
+    const Shard &shard = *m_shards.at(shardOfStream(streamIndex));
+    QMutexLocker locker(&shard.mutex);
+    const StreamTable::Record *record = shard.streams.find(streamIndex);
+    return record ? record->stream : TcpStream();
+}
+
+bool ConversationTracker::reassembleTcpStream(quint32 streamIndex) {
+    Shard &shard = *m_shards.at(shardOfStream(streamIndex));
+    QMutexLocker locker(&shard.mutex);
+
+    StreamTable::Record *record = shard.streams.find(streamIndex);
+    if (!record) {
+        return false;
+    }
+
+    // Only a closed stream may declare its holes lost: on a live one a late
+    // segment would then read as a retransmission and never fill its hole
+    TcpStream &stream = record->stream;
+    if (stream.isComplete) {
+        record->client.skipGaps();
+        record->server.skipGaps();
+    }
+
+    stream.clientData = record->client.flattenedData();
+    stream.serverData = record->server.flattenedData();
+    stream.clientNextSeq = record->client.nextSequence();
+    stream.serverNextSeq = record->server.nextSequence();
+    stream.clientGaps = record->client.gaps();
+    stream.serverGaps = record->server.gaps();
+    stream.hasGaps = record->client.hasGaps() || record->server.hasGaps();
+    locker.unlock();
+
+    emit tcpStreamUpdated(streamIndex);
+    return true;
+}
+
+QByteArray ConversationTracker::getStreamData(quint32 streamIndex, bool clientToServer) const {
+    const Shard &shard = *m_shards.at(shardOfStream(streamIndex));
+    QMutexLocker locker(&shard.mutex);
+    const StreamTable::Record *record = shard.streams.find(streamIndex);
+    if (!record) return QByteArray();
+    return clientToServer ? record->client.data() : record->server.data();
+}
+
+bool ConversationTracker::exportStreamData(quint32 streamIndex, const QString &filePath,
+                                           bool clientToServer) const {
+    QByteArray data;
+    {
+        const Shard &shard = *m_shards.at(shardOfStream(streamIndex));
+        QMutexLocker locker(&shard.mutex);
+        const StreamTable::Record *record = shard.streams.find(streamIndex);
+        if (!record) return false;
+        data = clientToServer ? record->client.data() : record->server.data();
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+    return file.write(data) == data.size();
+}
+
+bool ConversationTracker::exportStreamRaw(quint32 streamIndex, const QString &filePath) const {
+    TcpStream stream;
+    {
+        const Shard &shard = *m_shards.at(shardOfStream(streamIndex));
+        QMutexLocker locker(&shard.mutex);
+        const StreamTable::Record *record = shard.streams.find(streamIndex);
+        if (!record) {
+            return false;
+        }
+        stream = record->stream;
+        stream.clientData = record->client.data();
+        stream.serverData = record->server.data();
+    }
+
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out << stream.streamIndex << stream.conversationId
+        << stream.clientAddress << stream.clientPort
+        << stream.serverAddress << stream.serverPort
+        << stream.clientInitSeq << stream.serverInitSeq
+        << stream.clientGaps << stream.serverGaps
+        << stream.clientData << stream.serverData;
+    return out.status() == QDataStream::Ok;
 }
 
 quint32 ConversationTracker::getTcpStreamIndex(const std::shared_ptr<PacketModel> &packet) const {
-    QMutexLocker locker(&m_mutex);
-    QString convId = getConversationId(packet);
-    return m_tcpStreamMap.value(convId, 0);
+    if (!packet) return 0;
+    FlowKey key = FlowKey::fromAddresses(0, packet->srcIP, packet->srcPort,
+                                         packet->dstIP, packet->dstPort);
+
+    const Shard &shard = *m_shards.at(shardOf(key));
+    QMutexLocker locker(&shard.mutex);
+    if (!resolveProtocol(packet->protocol, &key)) return 0;
+    return shard.tcpStreamMap.value(key, 0);
 }
 
 quint64 ConversationTracker::getTotalConversations() const {
-    QMutexLocker locker(&m_mutex);
-    return m_conversations.size();
+    quint64 total = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        total += shard->conversations.size();
+    }
+    return total;
 }
 
 quint64 ConversationTracker::getTotalTcpStreams() const {
-    QMutexLocker locker(&m_mutex);
-    return m_tcpStreams.size();
+    quint64 total = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        total += shard->streams.size();
+    }
+    return total;
 }
 
 void ConversationTracker::setMaxConversations(quint64 max) {
-    QMutexLocker locker(&m_mutex);
     m_maxConversations = max;
 }
 
@@ -350,41 +1329,85 @@ void ConversationTracker::setEnableStreamReassembly(bool enable) {
 
 void ConversationTracker::setMaxStreamSize(quint64 maxBytes) {
     m_maxStreamSize = maxBytes;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->streams.forEach([maxBytes](StreamTable::Record &record) {
+            record.client.setMaxBytes(maxBytes);
+            record.server.setMaxBytes(maxBytes);
+        });
+    }
 }
 
-void ConversationTracker::enforceConversationLimit() {
-    // Remove oldest conversations if limit exceeded
-    while (m_conversations.size() > static_cast<int>(m_maxConversations)) {
-        QString oldestId;
-        QDateTime oldestTime = QDateTime::currentDateTime();
+void ConversationTracker::enforceConversationLimit(Shard &shard) {
+    // Evict least recently used conversations; O(1) per eviction
+    const quint64 limit = shardConversationLimit();
+    while (static_cast<quint64>(shard.conversations.size()) > limit) {
+        removeConversation(shard, shard.conversations.leastRecentlyUsed());
+    }
+}
 
-        for (auto it = m_conversations.constBegin(); it != m_conversations.constEnd(); ++it) {
-            if (it.value().endTime < oldestTime) {
-                oldestTime = it.value().endTime;
-                oldestId = it.key();
-            }
-        }
+void ConversationTracker::removeConversation(Shard &shard, quint32 slot) {
+    const FlowKey key = shard.conversations.keyAt(slot);
+    shard.conversations.remove(slot);
+    shard.packetRank.remove(key);
+    shard.byteRank.remove(key);
+    shard.dirtyConversations.remove(key);
 
-        if (!oldestId.isEmpty()) {
-            m_conversations.remove(oldestId);
-            if (m_tcpStreamMap.contains(oldestId)) {
-                quint32 streamIdx = m_tcpStreamMap.take(oldestId);
-                m_tcpStreams.remove(streamIdx);
-            }
+    auto streamIt = shard.tcpStreamMap.find(key);
+    if (streamIt != shard.tcpStreamMap.end()) {
+        shard.streams.remove(streamIt.value());
+        shard.dirtyStreams.remove(streamIt.value());
+        shard.tcpStreamMap.erase(streamIt);
+    }
+}
+
+void ConversationTracker::expireConversations(Shard &shard, qint64 nowSecs) {
+    if (m_conversationTimeout <= 0) return;
+
+    const QList<quint32> expired = shard.conversations.collectExpired(nowSecs);
+    for (quint32 slot : expired) {
+        removeConversation(shard, slot);
+    }
+}
+
+void ConversationTracker::cleanupOldConversations() {
+    if (m_conversationTimeout <= 0) return;
+
+    // Shards that saw no recent traffic are advanced to the newest packet time
+    qint64 nowSecs = -1;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        nowSecs = qMax(nowSecs, shard->clockSecs);
+    }
+    if (nowSecs < 0) return;
+
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        if (shard->clockSecs < nowSecs) {
+            shard->clockSecs = nowSecs;
+            expireConversations(*shard, nowSecs);
         }
     }
 }
 
 QHash<QString, quint64> ConversationTracker::getConversationCountByProtocol() const {
-    QMutexLocker locker(&m_mutex);
     QHash<QString, quint64> counts;
-    for (const auto &conv : m_conversations) {
-        counts[conv.protocol]++;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        shard->conversations.forEach([&counts](const Conversation &conv) {
+            counts[conv.protocol]++;
+        });
     }
     return counts;
 }
 
 QPair<quint64, quint64> ConversationTracker::getTotalTraffic() const {
-    QMutexLocker locker(&m_mutex);
-    return qMakePair(m_totalPackets, m_totalBytes);
+    quint64 packets = 0;
+    quint64 bytes = 0;
+    for (const auto &shard : m_shards) {
+        QMutexLocker locker(&shard->mutex);
+        packets += shard->totalPackets;
+        bytes += shard->totalBytes;
+    }
+    return qMakePair(packets, bytes);
 }
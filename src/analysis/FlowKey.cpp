@@ -0,0 +1,99 @@
+#include "analysis/FlowKey.h"
+#include <QHostAddress>
+
+namespace {
+
+// Fast path for dotted-quad IPv4 without going through QHostAddress
+bool parseIPv4(const QString &text, quint32 *out) {
+    const int len = text.size();
+    if (len < 7 || len > 15) return false;
+
+    const QChar *chars = text.constData();
+    quint32 result = 0;
+    quint32 octet = 0;
+    int digits = 0;
+    int dots = 0;
+
+    for (int i = 0; i < len; ++i) {
+        const ushort c = chars[i].unicode();
+        if (c >= '0' && c <= '9') {
+            octet = octet * 10 + (c - '0');
+            if (++digits > 3 || octet > 255) return false;
+        } else if (c == '.') {
+            if (digits == 0 || ++dots > 3) return false;
+            result = (result << 8) | octet;
+            octet = 0;
+            digits = 0;
+        } else {
+            return false;
+        }
+    }
+
+    if (dots != 3 || digits == 0) return false;
+    *out = (result << 8) | octet;
+    return true;
+}
+
+} // namespace
+
+bool FlowKey::encodeAddress(const QString &address, FlowEndpoint &endpoint) {
+    quint32 v4 = 0;
+    if (parseIPv4(address, &v4)) {
+        endpoint.addr[0] = 0;
+        endpoint.addr[1] = 0x0000FFFF00000000ULL | v4;
+        return true;
+    }
+
+    if (address.contains(QLatin1Char(':'))) {
+        QHostAddress host;
+        if (host.setAddress(address) &&
+            host.protocol() == QAbstractSocket::IPv6Protocol) {
+            const Q_IPV6ADDR v6 = host.toIPv6Address();
+            quint64 hi = 0;
+            quint64 lo = 0;
+            for (int i = 0; i < 8; ++i) {
+                hi = (hi << 8) | v6[i];
+                lo = (lo << 8) | v6[i + 8];
+            }
+            endpoint.addr[0] = hi;
+            endpoint.addr[1] = lo;
+            return true;
+        }
+    }
+
+    // Non-IP address (MAC, empty, ...): fall back to a 128-bit hash
+    endpoint.addr[0] = qHash(address, 0x5BD1E995U) |
+                       (static_cast<quint64>(qHash(address, 0x1B873593U)) << 32);
+    endpoint.addr[1] = qHash(address, 0xCC9E2D51U) |
+                       (static_cast<quint64>(qHash(address, 0x85EBCA6BU)) << 32);
+    return false;
+}
+
+FlowKey FlowKey::fromAddresses(quint16 protocol,
+                               const QString &srcAddr, quint16 srcPort,
+                               const QString &dstAddr, quint16 dstPort,
+                               bool *reversed) {
+    FlowEndpoint src;
+    FlowEndpoint dst;
+    bool isIp = encodeAddress(srcAddr, src);
+    isIp = encodeAddress(dstAddr, dst) && isIp;
+    src.port = srcPort;
+    dst.port = dstPort;
+
+    const bool swap = dst < src;
+    const FlowEndpoint &lo = swap ? dst : src;
+    const FlowEndpoint &hi = swap ? src : dst;
+
+    FlowKey key;
+    key.lowAddr[0] = lo.addr[0];
+    key.lowAddr[1] = lo.addr[1];
+    key.highAddr[0] = hi.addr[0];
+    key.highAddr[1] = hi.addr[1];
+    key.lowPort = lo.port;
+    key.highPort = hi.port;
+    key.protocol = protocol;
+    key.flags = isIp ? 0 : HashedAddresses;
+
+    if (reversed) *reversed = swap;
+    return key;
+}
@@ -0,0 +1,125 @@
+#include "analysis/Histogram.h"
+#include <QtAlgorithms>
+#include <cmath>
+
+Histogram::Histogram(int precision)
+    : m_precision(qBound(2, precision, 20))
+    , m_total(0)
+    , m_sum(0)
+    , m_min(0)
+    , m_max(0)
+{
+}
+
+int Histogram::bucketIndex(quint64 value) const {
+    if (value < (Q_UINT64_C(1) << m_precision)) {
+        return static_cast<int>(value);
+    }
+    // Shift so the value keeps precision significant bits; each shift is a
+    // power-of-two range of half as many buckets as the linear part
+    const int shift = (63 - qCountLeadingZeroBits(value)) - (m_precision - 1);
+    return (shift << (m_precision - 1)) + static_cast<int>(value >> shift);
+}
+
+quint64 Histogram::lowestValue(int index) const {
+    const int linear = 1 << m_precision;
+    if (index < linear) {
+        return static_cast<quint64>(index);
+    }
+    const int half = linear >> 1;
+    const int shift = (index - linear) / half + 1;
+    return static_cast<quint64>(index - (shift << (m_precision - 1))) << shift;
+}
+
+quint64 Histogram::highestValue(int index) const {
+    const int linear = 1 << m_precision;
+    if (index < linear) {
+        return static_cast<quint64>(index);
+    }
+    const int shift = (index - linear) / (linear >> 1) + 1;
+    return lowestValue(index) + (Q_UINT64_C(1) << shift) - 1;
+}
+
+void Histogram::record(quint64 value, quint64 count) {
+    if (count == 0) return;
+    const int index = bucketIndex(value);
+    if (index >= m_counts.size()) {
+        m_counts.resize(index + 1);
+    }
+    m_counts[index] += count;
+
+    if (m_total == 0 || value < m_min) m_min = value;
+    m_max = qMax(m_max, value);
+    m_total += count;
+    m_sum += value * count;
+}
+
+void Histogram::merge(const Histogram &other) {
+    if (other.m_total == 0) return;
+    if (other.m_precision != m_precision) {
+        // Re-bucket at this precision; each bucket is represented by its lower bound
+        const quint64 total = m_total + other.m_total;
+        const quint64 sum = m_sum + other.m_sum;
+        const quint64 low = m_total ? qMin(m_min, other.m_min) : other.m_min;
+        const quint64 high = qMax(m_max, other.m_max);
+        other.forEachBucket([this](quint64 lowest, quint64, quint64 count) {
+            record(lowest, count);
+        });
+        m_total = total;
+        m_sum = sum;
+        m_min = low;
+        m_max = high;
+        return;
+    }
+
+    if (m_counts.size() < other.m_counts.size()) {
+        m_counts.resize(other.m_counts.size());
+    }
+    quint64 *counts = m_counts.data();
+    const quint64 *from = other.m_counts.constData();
+    for (int i = 0; i < other.m_counts.size(); ++i) {
+        counts[i] += from[i];
+    }
+
+    if (m_total == 0 || other.m_min < m_min) m_min = other.m_min;
+    m_max = qMax(m_max, other.m_max);
+    m_total += other.m_total;
+    m_sum += other.m_sum;
+}
+
+void Histogram::clear() {
+    m_counts.clear();
+    m_total = 0;
+    m_sum = 0;
+    m_min = 0;
+    m_max = 0;
+}
+
+quint64 Histogram::valueAtPercentile(double percentile) const {
+    if (m_total == 0) return 0;
+
+    // Nearest rank, 1-based; a rank of 0 is the minimum
+    const double fraction = qBound(0.0, percentile, 100.0) / 100.0;
+    const quint64 rank = static_cast<quint64>(std::ceil(fraction * m_total));
+    if (rank == 0) return m_min;
+
+    quint64 seen = 0;
+    for (int i = 0; i < m_counts.size(); ++i) {
+        seen += m_counts.at(i);
+        if (seen >= rank) {
+            return qBound(m_min, highestValue(i), m_max);
+        }
+    }
+    return m_max;
+}
+
+quint64 Histogram::countBetween(quint64 low, quint64 high) const {
+    if (m_total == 0 || low >= high) return 0;
+    quint64 count = 0;
+    for (int i = bucketIndex(low); i < m_counts.size(); ++i) {
+        const quint64 lowest = lowestValue(i);
+        if (lowest >= high) break;
+        if (lowest >= low) count += m_counts.at(i);
+    }
+    return count;
+}
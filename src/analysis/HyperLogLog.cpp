@@ -0,0 +1,124 @@
+#include "analysis/HyperLogLog.h"
+#include <QtAlgorithms>
+#include <algorithm>
+#include <iterator>
+#include <cmath>
+
+HyperLogLog::HyperLogLog(int precision)
+    : m_precision(qBound(4, precision, 16))
+{
+}
+
+quint64 HyperLogLog::hash(quint64 key) {
+    key += Q_UINT64_C(0x9E3779B97F4A7C15);
+    key = (key ^ (key >> 30)) * Q_UINT64_C(0xBF58476D1CE4E5B9);
+    key = (key ^ (key >> 27)) * Q_UINT64_C(0x94D049BB133111EB);
+    return key ^ (key >> 31);
+}
+
+void HyperLogLog::add(quint64 hash) {
+    if (isDense()) {
+        addToRegisters(hash);
+        return;
+    }
+
+    auto it = std::lower_bound(m_sparse.begin(), m_sparse.end(), hash);
+    if (it != m_sparse.end() && *it == hash) return;
+    m_sparse.insert(it, hash);
+    if (m_sparse.size() > maxSparse()) {
+        convertToRegisters();
+    }
+}
+
+void HyperLogLog::addToRegisters(quint64 hash) {
+    const int index = static_cast<int>(hash >> (64 - m_precision));
+
+    // Rank of the first set bit below the index bits; a guard bit caps it
+    const quint64 rest = (hash << m_precision) | (Q_UINT64_C(1) << (m_precision - 1));
+    const quint8 rank = static_cast<quint8>(qCountLeadingZeroBits(rest) + 1);
+    if (rank > m_registers.at(index)) {
+        m_registers[index] = rank;
+    }
+}
+
+void HyperLogLog::convertToRegisters() {
+    m_registers.fill(0, 1 << m_precision);
+    for (quint64 hash : m_sparse) {
+        addToRegisters(hash);
+    }
+    m_sparse.clear();
+    m_sparse.squeeze();
+}
+
+void HyperLogLog::merge(const HyperLogLog &other) {
+    if (other.isEmpty()) return;
+    Q_ASSERT(other.m_precision == m_precision);
+
+    if (!other.isDense()) {
+        if (isDense()) {
+            for (quint64 hash : other.m_sparse) {
+                addToRegisters(hash);
+            }
+            return;
+        }
+        QVector<quint64> merged;
+        merged.reserve(m_sparse.size() + other.m_sparse.size());
+        std::set_union(m_sparse.constBegin(), m_sparse.constEnd(), other.m_sparse.constBegin(),
+                       other.m_sparse.constEnd(), std::back_inserter(merged));
+        m_sparse.swap(merged);
+        if (m_sparse.size() > maxSparse()) {
+            convertToRegisters();
+        }
+        return;
+    }
+    if (isEmpty()) {
+        m_registers = other.m_registers;
+        return;
+    }
+    if (!isDense()) {
+        convertToRegisters();
+    }
+
+    quint8 *registers = m_registers.data();
+    const quint8 *from = other.m_registers.constData();
+    for (int i = 0; i < m_registers.size(); ++i) {
+        registers[i] = qMax(registers[i], from[i]);
+    }
+}
+
+void HyperLogLog::clear() {
+    m_sparse.clear();
+    m_registers.clear();
+}
+
+double HyperLogLog::relativeError() const {
+    return 1.04 / std::sqrt(static_cast<double>(1 << m_precision));
+}
+
+quint64 HyperLogLog::estimate() const {
+    if (!isDense()) return static_cast<quint64>(m_sparse.size());
+
+    const int m = m_registers.size();
+    double sum = 0.0;
+    int zeros = 0;
+    for (quint8 rank : m_registers) {
+        sum += std::ldexp(1.0, -rank);
+        if (rank == 0) ++zeros;
+    }
+
+    double alpha;
+    switch (m) {
+    case 16: alpha = 0.673; break;
+    case 32: alpha = 0.697; break;
+    case 64: alpha = 0.709; break;
+    default: alpha = 0.7213 / (1.0 + 1.079 / m); break;
+    }
+    double estimate = alpha * m * m / sum;
+
+    // Small range: count empty registers instead; 64-bit hashes need no
+    // large-range correction
+    if (estimate <= 2.5 * m && zeros > 0) {
+        estimate = m * std::log(static_cast<double>(m) / zeros);
+    }
+    return static_cast<quint64>(estimate + 0.5);
+}
@@ -0,0 +1,105 @@
+#include "analysis/PacketNumberList.h"
+
+void PacketNumberList::append(quint64 number) {
+    if (m_size % BlockSize == 0) {
+        m_blocks.append(Block(number, m_deltas.size()));
+    } else {
+        // Zig-zag keeps small backward steps (reordered captures) small
+        const qint64 delta = static_cast<qint64>(number - m_last);
+        quint64 zigzag = (static_cast<quint64>(delta) << 1) ^ static_cast<quint64>(delta >> 63);
+        while (zigzag >= 0x80) {
+            m_deltas.append(static_cast<char>((zigzag & 0x7F) | 0x80));
+            zigzag >>= 7;
+        }
+        m_deltas.append(static_cast<char>(zigzag));
+    }
+    m_last = number;
+    ++m_size;
+}
+
+quint64 PacketNumberList::decodeNext(int *pos, quint64 previous) const {
+    const uchar *data = reinterpret_cast<const uchar *>(m_deltas.constData());
+    quint64 zigzag = 0;
+    int shift = 0;
+    uchar byte;
+    do {
+        byte = data[(*pos)++];
+        zigzag |= static_cast<quint64>(byte & 0x7F) << shift;
+        shift += 7;
+    } while (byte & 0x80);
+
+    const qint64 delta = static_cast<qint64>(zigzag >> 1) ^ -static_cast<qint64>(zigzag & 1);
+    return previous + static_cast<quint64>(delta);
+}
+
+quint64 PacketNumberList::at(int index) const {
+    if (index < 0 || index >= m_size) return 0;
+    if (index == m_size - 1) return m_last;
+
+    const Block &block = m_blocks.at(index / BlockSize);
+    quint64 value = block.first;
+    int pos = block.offset;
+    for (int i = index % BlockSize; i > 0; --i) {
+        value = decodeNext(&pos, value);
+    }
+    return value;
+}
+
+QList<quint64> PacketNumberList::mid(int index, int count) const {
+    QList<quint64> result;
+    if (index < 0 || index >= m_size) return result;
+
+    const int stop = (count < 0 || count > m_size - index) ? m_size : index + count;
+    result.reserve(stop - index);
+    for (const_iterator it(this, index); it.m_index < stop; ++it) {
+        result.append(*it);
+    }
+    return result;
+}
+
+int PacketNumberList::encodedSize() const {
+    return m_deltas.size() + m_blocks.size() * static_cast<int>(sizeof(Block));
+}
+
+void PacketNumberList::squeeze() {
+    m_deltas.squeeze();
+    m_blocks.squeeze();
+}
+
+void PacketNumberList::clear() {
+    m_deltas.clear();
+    m_blocks.clear();
+    m_size = 0;
+    m_last = 0;
+}
+
+PacketNumberList::const_iterator::const_iterator(const PacketNumberList *list, int index)
+    : m_list(list)
+    , m_index(index)
+    , m_pos(0)
+    , m_value(0)
+{
+    if (index >= list->m_size) return;
+
+    // Seek within the block containing index
+    const Block &block = list->m_blocks.at(index / BlockSize);
+    m_value = block.first;
+    m_pos = block.offset;
+    for (int i = index % BlockSize; i > 0; --i) {
+        m_value = list->decodeNext(&m_pos, m_value);
+    }
+}
+
+PacketNumberList::const_iterator &PacketNumberList::const_iterator::operator++() {
+    ++m_index;
+    if (m_index >= m_list->m_size) return *this;
+
+    if (m_index % BlockSize == 0) {
+        const Block &block = m_list->m_blocks.at(m_index / BlockSize);
+        m_value = block.first;
+        m_pos = block.offset;
+    } else {
+        m_value = m_list->decodeNext(&m_pos, m_value);
+    }
+    return *this;
+}
@@ -0,0 +1,120 @@
+#include "analysis/ParallelAnalysis.h"
+#include "analysis/ConversationTracker.h"
+#include "analysis/FlowKey.h"
+#include "analysis/StatisticsEngine.h"
+#include "analysis/Timestamp.h"
+#include <QtConcurrent>
+
+/**
+ * @brief One worker's private engines and its batch in flight
+ */
+struct ParallelAnalysis::Worker {
+    std::unique_ptr<StatisticsEngine> statistics;
+    std::unique_ptr<ConversationTracker> tracker;
+    QFuture<void> pending;
+
+    Worker() : statistics(new StatisticsEngine()), tracker(new ConversationTracker()) {}
+};
+
+ParallelAnalysis::ParallelAnalysis(int workers, Partitioning partitioning)
+    : m_workerCount(qBound(1, workers, 256))
+    , m_partitioning(partitioning)
+    , m_nextWorker(0)
+{
+    m_pool.setMaxThreadCount(m_workerCount);
+}
+
+ParallelAnalysis::~ParallelAnalysis() {
+    waitForFinished();
+}
+
+void ParallelAnalysis::setConfigurator(const Configurator &configure) {
+    m_configure = configure;
+}
+
+void ParallelAnalysis::createWorkers() {
+    // Engines are QObjects and belong to the calling thread; workers only call their ingest paths
+    for (int i = 0; i < m_workerCount; ++i) {
+        auto worker = std::make_shared<Worker>();
+        if (m_configure) {
+            m_configure(worker->statistics.get(), worker->tracker.get());
+        }
+        m_workers.append(worker);
+    }
+}
+
+void ParallelAnalysis::addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                                  const QVector<qint64> &timestampsUs) {
+    if (packets.isEmpty()) return;
+    if (m_workers.isEmpty()) {
+        createWorkers();
+    }
+
+    if (m_partitioning == ByTime || m_workerCount == 1) {
+        Worker &worker = *m_workers.at(m_nextWorker);
+        m_nextWorker = (m_nextWorker + 1) % m_workerCount;
+        submit(worker, packets, timestampsUs);
+        return;
+    }
+
+    // Both directions of a flow hash alike, as in ConversationTracker's shards
+    const bool timed = !timestampsUs.isEmpty();
+    QVector<QList<std::shared_ptr<PacketModel>>> slices(m_workerCount);
+    QVector<QVector<qint64>> sliceTimes(timed ? m_workerCount : 0);
+    for (auto &slice : slices) {
+        slice.reserve(packets.size() / m_workerCount + 1);
+    }
+    for (int i = 0; i < packets.size(); ++i) {
+        const auto &packet = packets.at(i);
+        if (!packet) continue;
+        const FlowKey key = FlowKey::fromAddresses(0, packet->srcIP, packet->srcPort,
+                                                   packet->dstIP, packet->dstPort);
+        const quint64 h = key.endpointHash() & 0xFFFFFFFFULL;
+        const int worker = static_cast<int>((h * static_cast<quint64>(m_workerCount)) >> 32);
+        slices[worker].append(packet);
+        if (timed) {
+            sliceTimes[worker].append(batchTimestampUs(*packet, timestampsUs, i));
+        }
+    }
+    for (int i = 0; i < m_workerCount; ++i) {
+        if (!slices.at(i).isEmpty()) {
+            submit(*m_workers.at(i), slices.at(i), timed ? sliceTimes.at(i) : QVector<qint64>());
+        }
+    }
+}
+
+void ParallelAnalysis::submit(Worker &worker, const QList<std::shared_ptr<PacketModel>> &packets,
+                              const QVector<qint64> &timestampsUs) {
+    // One batch in flight per worker keeps its packets in order
+    worker.pending.waitForFinished();
+    StatisticsEngine *statistics = worker.statistics.get();
+    ConversationTracker *tracker = worker.tracker.get();
+    worker.pending = QtConcurrent::run(&m_pool, [statistics, tracker, packets, timestampsUs]() {
+        statistics->addPackets(packets, timestampsUs);
+        tracker->addPackets(packets, timestampsUs);
+    });
+}
+
+void ParallelAnalysis::waitForFinished() {
+    for (const auto &worker : m_workers) {
+        worker->pending.waitForFinished();
+    }
+}
+
+void ParallelAnalysis::mergeInto(StatisticsEngine *statistics, ConversationTracker *tracker) {
+    waitForFinished();
+    for (const auto &worker : m_workers) {
+        if (statistics) {
+            statistics->merge(*worker->statistics);
+        }
+        if (tracker) {
+            tracker->merge(*worker->tracker);
+        }
+    }
+}
+
+void ParallelAnalysis::clear() {
+    waitForFinished();
+    m_workers.clear();
+    m_nextWorker = 0;
+}
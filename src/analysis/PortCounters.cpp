@@ -0,0 +1,71 @@
+#include "analysis/PortCounters.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+const int BlockSize = 8;
+
+typedef QPair<quint64, quint16> Entry;          // (count, port); min-heap on count
+
+bool heapGreater(const Entry &a, const Entry &b) {
+    return a.first > b.first || (a.first == b.first && a.second < b.second);
+}
+
+} // namespace
+
+QList<QPair<quint16, quint64>> PortCounters::top(int k) const {
+    QList<QPair<quint16, quint64>> result;
+    if (k <= 0 || m_counts.isEmpty()) return result;
+
+    std::vector<Entry> heap;
+    heap.reserve(static_cast<size_t>(qMin<int>(k, PortCount)));
+    quint64 threshold = 0;                       // Counts must exceed this to enter
+
+    const quint64 *counts = m_counts.constData();
+    for (int base = 0; base < PortCount; base += BlockSize) {
+        const quint64 *block = counts + base;
+        quint64 blockMax = block[0];
+        for (int i = 1; i < BlockSize; ++i) {
+            blockMax = block[i] > blockMax ? block[i] : blockMax;
+        }
+        if (blockMax <= threshold) continue;
+
+        for (int i = 0; i < BlockSize; ++i) {
+            if (block[i] <= threshold) continue;
+            const Entry entry(block[i], static_cast<quint16>(base + i));
+            if (static_cast<int>(heap.size()) < k) {
+                heap.push_back(entry);
+                std::push_heap(heap.begin(), heap.end(), heapGreater);
+            } else {
+                std::pop_heap(heap.begin(), heap.end(), heapGreater);
+                heap.back() = entry;
+                std::push_heap(heap.begin(), heap.end(), heapGreater);
+            }
+            if (static_cast<int>(heap.size()) == k) {
+                threshold = heap.front().first;
+            }
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), heapGreater);
+    result.reserve(static_cast<int>(heap.size()));
+    for (const Entry &entry : heap) {
+        result.append(qMakePair(entry.second, entry.first));
+    }
+    return result;
+}
+
+void PortCounters::merge(const PortCounters &other) {
+    if (other.m_counts.isEmpty()) return;
+    if (m_counts.isEmpty()) {
+        m_counts = other.m_counts;
+        return;
+    }
+
+    quint64 *counts = m_counts.data();
+    const quint64 *otherCounts = other.m_counts.constData();
+    for (int port = 0; port < PortCount; ++port) {
+        counts[port] += otherCounts[port];
+    }
+}
@@ -0,0 +1,81 @@
+#include "analysis/PortSet.h"
+#include <QtAlgorithms>
+#include <algorithm>
+
+bool PortSet::contains(quint16 port) const {
+    if (isDense()) {
+        return (m_bits.at(port >> 6) >> (port & 63)) & 1;
+    }
+    return std::binary_search(m_sparse.constBegin(), m_sparse.constEnd(), port);
+}
+
+bool PortSet::insert(quint16 port) {
+    if (isDense()) {
+        quint64 &word = m_bits[port >> 6];
+        const quint64 bit = quint64(1) << (port & 63);
+        if (word & bit) return false;
+        word |= bit;
+        ++m_size;
+        return true;
+    }
+
+    auto it = std::lower_bound(m_sparse.begin(), m_sparse.end(), port);
+    if (it != m_sparse.end() && *it == port) return false;
+    m_sparse.insert(it, port);
+    ++m_size;
+    if (m_size > MaxSparse) {
+        convertToBitset();
+    }
+    return true;
+}
+
+void PortSet::unite(const PortSet &other) {
+    if (other.isDense()) {
+        if (!isDense()) convertToBitset();
+        m_size = 0;
+        for (int i = 0; i < BitsetWords; ++i) {
+            m_bits[i] |= other.m_bits.at(i);
+            m_size += static_cast<int>(qPopulationCount(m_bits.at(i)));
+        }
+        return;
+    }
+    for (quint16 port : other.m_sparse) {
+        insert(port);
+    }
+}
+
+QList<quint16> PortSet::values() const {
+    QList<quint16> result;
+    result.reserve(m_size);
+    if (!isDense()) {
+        for (quint16 port : m_sparse) {
+            result.append(port);
+        }
+        return result;
+    }
+
+    for (int i = 0; i < BitsetWords; ++i) {
+        quint64 word = m_bits.at(i);
+        while (word) {
+            const int bit = static_cast<int>(qCountTrailingZeroBits(word));
+            result.append(static_cast<quint16>(i * 64 + bit));
+            word &= word - 1;
+        }
+    }
+    return result;
+}
+
+void PortSet::clear() {
+    m_sparse.clear();
+    m_bits.clear();
+    m_size = 0;
+}
+
+void PortSet::convertToBitset() {
+    m_bits.fill(0, BitsetWords);
+    for (quint16 port : m_sparse) {
+        m_bits[port >> 6] |= quint64(1) << (port & 63);
+    }
+    m_sparse.clear();
+    m_sparse.squeeze();
+}
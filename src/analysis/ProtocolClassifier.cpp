@@ -0,0 +1,267 @@
+#include "analysis/ProtocolClassifier.h"
+#include <algorithm>
+
+namespace {
+
+const quint16 InvalidState = 0xFFFF;
+const int MaxHeaderScan = 2048;              // Bytes searched for the HTTP Host header
+
+inline quint16 readBE16(const uchar *p) {
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+inline uchar asciiLower(uchar c) {
+    return (c >= 'A' && c <= 'Z') ? static_cast<uchar>(c + ('a' - 'A')) : c;
+}
+
+// Server name from a TLS ClientHello; data starts at the record header
+QString clientHelloServerName(const uchar *data, int length) {
+    // Record (5) + handshake header (4) + version (2) + random (32)
+    int pos = 5 + 4 + 2 + 32;
+    if (pos + 1 > length) return QString();
+    pos += 1 + data[pos];                                   // Session ID
+    if (pos + 2 > length) return QString();
+    pos += 2 + readBE16(data + pos);                        // Cipher suites
+    if (pos + 1 > length) return QString();
+    pos += 1 + data[pos];                                   // Compression methods
+    if (pos + 2 > length) return QString();
+    const int extensionsEnd = qMin(length, pos + 2 + readBE16(data + pos));
+    pos += 2;
+
+    while (pos + 4 <= extensionsEnd) {
+        const quint16 type = readBE16(data + pos);
+        const int size = readBE16(data + pos + 2);
+        pos += 4;
+        if (type == 0 && pos + 5 <= extensionsEnd) {        // server_name
+            // List length (2), name type (1), name length (2)
+            const int nameLength = readBE16(data + pos + 3);
+            if (data[pos + 2] == 0 && pos + 5 + nameLength <= extensionsEnd) {
+                return QString::fromLatin1(reinterpret_cast<const char *>(data + pos + 5),
+                                           nameLength);
+            }
+            return QString();
+        }
+        pos += size;
+    }
+    return QString();
+}
+
+// Value of the Host header of an HTTP request head
+QString httpHost(const uchar *data, int length) {
+    static const char prefix[] = "\r\nhost:";
+    const int prefixLength = static_cast<int>(sizeof(prefix)) - 1;
+    const int end = qMin(length, MaxHeaderScan);
+
+    for (int i = 0; i + prefixLength <= end; ++i) {
+        int j = 0;
+        while (j < prefixLength && asciiLower(data[i + j]) == static_cast<uchar>(prefix[j])) ++j;
+        if (j < prefixLength) continue;
+
+        int start = i + prefixLength;
+        while (start < end && data[start] == ' ') ++start;
+        int stop = start;
+        while (stop < end && data[stop] != '\r' && data[stop] != '\n') ++stop;
+        if (stop == end) return QString();                 // Header cut off by the snap length
+        return QString::fromLatin1(reinterpret_cast<const char *>(data + start), stop - start);
+    }
+    return QString();
+}
+
+// A DNS message with one or more well-formed questions
+bool looksLikeDns(const uchar *data, int length) {
+    if (length < 12 + 5) return false;
+    const int opcode = (data[2] >> 3) & 0x0F;
+    if (opcode > 5 || opcode == 3) return false;
+    if (data[3] & 0x40) return false;                      // Reserved Z bit
+    const int questions = readBE16(data + 4);
+    if (questions < 1 || questions > 16) return false;
+
+    // The first question name must be a label sequence ending in the root
+    int pos = 12;
+    while (pos < length && data[pos] != 0) {
+        if (data[pos] > 63) return false;                  // No compression in the first name
+        pos += 1 + data[pos];
+    }
+    if (pos + 5 > length) return false;
+    const int qclass = readBE16(data + pos + 3) & 0x7FFF; // Top bit: mDNS unicast response
+    return qclass == 1 || qclass == 3 || qclass == 4 || qclass == 255;
+}
+
+ProtocolClassifier buildStandard() {
+    ProtocolClassifier classifier;
+    const ProtocolClassifier::Transport tcp = ProtocolClassifier::TcpOnly;
+    const ProtocolClassifier::Transport udp = ProtocolClassifier::UdpOnly;
+
+    // Listed most specific first; SIP shares request methods with HTTP
+    classifier.addSignature("SIP", "SIP/2.0 ", 0);
+    classifier.addSignature("SIP", " sip:", -1);
+    classifier.addSignature("HTTP2", "PRI * HTTP/2.0\r\n", 0, tcp);
+    static const char *const methods[] = {
+        "GET ", "POST ", "HEAD ", "PUT ", "DELETE ", "OPTIONS ", "PATCH ", "CONNECT ", "TRACE "
+    };
+    for (const char *method : methods) {
+        classifier.addSignature("HTTP", method, 0, tcp, ProtocolClassifier::HttpRequest);
+    }
+    classifier.addSignature("HTTP", "HTTP/1.", 0, tcp);
+    classifier.addSignature("RTSP", "RTSP/1.0 ", 0, tcp);
+    for (const char *version : {"\x16\x03\x00", "\x16\x03\x01", "\x16\x03\x02", "\x16\x03\x03"}) {
+        classifier.addSignature("TLS", QByteArray(version, 3), 0, tcp,
+                                ProtocolClassifier::TlsRecord);
+    }
+    classifier.addSignature("SSH", "SSH-", 0, tcp);
+    classifier.addSignature("SMTP", "EHLO ", 0, tcp);
+    classifier.addSignature("SMTP", "HELO ", 0, tcp);
+    classifier.addSignature("POP3", "+OK ", 0, tcp);
+    classifier.addSignature("IMAP", "* OK ", 0, tcp);
+    classifier.addSignature("SMB", "\xFFSMB", 4, tcp);
+    classifier.addSignature("SMB", "\xFESMB", 4, tcp);
+    classifier.addSignature("BitTorrent", "\x13" "BitTorrent protocol", 0, tcp);
+    classifier.addSignature("QUIC", QByteArray("\x00\x00\x00\x01", 4), 1, udp,
+                            ProtocolClassifier::QuicLongHeader);
+    classifier.addSignature("QUIC", QByteArray("\x6B\x33\x43\xCF", 4), 1, udp,
+                            ProtocolClassifier::QuicLongHeader);
+    classifier.compile();
+    return classifier;
+}
+
+} // namespace
+
+const ProtocolClassifier &ProtocolClassifier::standard() {
+    static const ProtocolClassifier classifier = buildStandard();
+    return classifier;
+}
+
+ProtocolClassifier::ProtocolClassifier()
+    : m_compiled(false)
+{
+}
+
+void ProtocolClassifier::addSignature(const QString &protocol, const QByteArray &pattern,
+                                      int offset, Transport transport, Check check) {
+    if (pattern.isEmpty()) return;
+    Signature signature;
+    signature.protocol = protocol;
+    signature.pattern = pattern;
+    signature.offset = offset;
+    signature.transport = transport;
+    signature.check = check;
+    m_signatures.append(signature);
+    m_compiled = false;
+}
+
+void ProtocolClassifier::compile() {
+    m_transitions.fill(InvalidState, 256);
+    m_outputs.clear();
+    m_outputs.resize(1);
+
+    // Trie of all patterns
+    for (int index = 0; index < m_signatures.size(); ++index) {
+        const QByteArray &pattern = m_signatures.at(index).pattern;
+        int state = 0;
+        for (int i = 0; i < pattern.size(); ++i) {
+            const int slot = state * 256 + static_cast<uchar>(pattern.at(i));
+            if (m_transitions.at(slot) == InvalidState) {
+                Q_ASSERT(m_outputs.size() < InvalidState);
+                m_transitions[slot] = static_cast<quint16>(m_outputs.size());
+                m_transitions.resize(m_transitions.size() + 256);
+                std::fill(m_transitions.end() - 256, m_transitions.end(), InvalidState);
+                m_outputs.append(QVector<quint16>());
+            }
+            state = m_transitions.at(slot);
+        }
+        m_outputs[state].append(static_cast<quint16>(index));
+    }
+
+    // Breadth-first failure links, folded into a complete transition table
+    QVector<quint16> failure(m_outputs.size(), 0);
+    QVector<quint16> queue;
+    for (int c = 0; c < 256; ++c) {
+        quint16 &next = m_transitions[c];
+        if (next == InvalidState) {
+            next = 0;
+        } else {
+            queue.append(next);
+        }
+    }
+    for (int head = 0; head < queue.size(); ++head) {
+        const quint16 state = queue.at(head);
+        const quint16 fail = failure.at(state);
+        for (int c = 0; c < 256; ++c) {
+            const int slot = state * 256 + c;
+            const quint16 next = m_transitions.at(slot);
+            if (next == InvalidState) {
+                m_transitions[slot] = m_transitions.at(fail * 256 + c);
+            } else {
+                failure[next] = m_transitions.at(fail * 256 + c);
+                m_outputs[next] += m_outputs.at(failure.at(next));
+                queue.append(next);
+            }
+        }
+    }
+
+    for (auto &outputs : m_outputs) {
+        std::sort(outputs.begin(), outputs.end());
+    }
+    m_compiled = true;
+}
+
+ProtocolClassifier::Match ProtocolClassifier::classify(const uchar *data, int length,
+                                                       bool udp) const {
+    Match match;
+    if (!m_compiled || !data || length <= 0) return match;
+
+    const quint16 *transitions = m_transitions.constData();
+    const int scan = qMin(length, static_cast<int>(ScanLength));
+    int best = m_signatures.size();
+    quint16 state = 0;
+
+    for (int i = 0; i < scan && best > 0; ++i) {
+        state = transitions[state * 256 + data[i]];
+        for (quint16 index : m_outputs.at(state)) {
+            if (index >= best) break;
+            const Signature &signature = m_signatures.at(index);
+            if (signature.offset >= 0 && signature.offset != i + 1 - signature.pattern.size()) {
+                continue;
+            }
+            Match candidate;
+            if (accepts(signature, data, length, udp, &candidate)) {
+                best = index;
+                match = candidate;
+            }
+        }
+    }
+
+    if (!match.isValid() && udp && looksLikeDns(data, length)) {
+        match.protocol = QStringLiteral("DNS");
+    }
+    return match;
+}
+
+bool ProtocolClassifier::accepts(const Signature &signature, const uchar *data, int length,
+                                 bool udp, Match *match) const {
+    if ((signature.transport == TcpOnly && udp) || (signature.transport == UdpOnly && !udp)) {
+        return false;
+    }
+
+    switch (signature.check) {
+    case TlsRecord: {
+        // Handshake record with a plausible handshake type
+        if (length < 6 || data[5] == 0 || data[5] > 24) return false;
+        if (data[5] == 1) {
+            match->serverName = clientHelloServerName(data, length);
+        }
+        break;
+    }
+    case HttpRequest:
+        match->serverName = httpHost(data, length);
+        break;
+    case QuicLongHeader:
+        if ((data[0] & 0xC0) != 0xC0) return false;
+        break;
+    case NoCheck:
+        break;
+    }
+
+    match->protocol = signature.protocol;
+    return true;
+}
@@ -0,0 +1,166 @@
+#include "analysis/RateSeries.h"
+
+namespace {
+
+const qint64 LevelResolutionMs[RateSeries::ResolutionCount] = {1, 1000, 60 * 1000, 60 * 60 * 1000};
+
+// Buckets kept per level: 10 s (1 s compact), 1 h, 1 day, 30 days
+const int FullMillisecondSlots = 10000;
+const int CompactMillisecondSlots = 1000;
+const int LevelCapacity[RateSeries::ResolutionCount] = {FullMillisecondSlots, 3600, 1440, 720};
+
+qint64 floorDiv(qint64 value, qint64 divisor) {
+    qint64 quotient = value / divisor;
+    if ((value % divisor) < 0) --quotient;
+    return quotient;
+}
+
+} // namespace
+
+RateSeries::RateSeries(Retention retention) {
+    for (int i = 0; i < ResolutionCount; ++i) {
+        m_levels[i].resolutionMs = LevelResolutionMs[i];
+        m_levels[i].capacity = LevelCapacity[i];
+    }
+    if (retention == Compact) {
+        m_levels[Millisecond].capacity = CompactMillisecondSlots;
+    }
+}
+
+void RateSeries::add(qint64 ms, quint64 packets, quint64 bytes) {
+    for (Level &level : m_levels) {
+        level.add(floorDiv(ms, level.resolutionMs), packets, bytes);
+    }
+}
+
+void RateSeries::clear() {
+    for (Level &level : m_levels) {
+        level.buckets.clear();
+        level.head = 0;
+        level.base = Totals();
+    }
+}
+
+void RateSeries::merge(const RateSeries &other) {
+    for (int i = 0; i < ResolutionCount; ++i) {
+        m_levels[i].merge(other.m_levels[i]);
+    }
+}
+
+QVector<RateSeries::Sample> RateSeries::resample(qint64 fromMs, qint64 toMs, int intervalMs) const {
+    QVector<Sample> samples;
+    if (intervalMs <= 0 || fromMs >= toMs || isEmpty()) return samples;
+
+    const Level *level = levelFor(fromMs, intervalMs);
+    if (!level) return samples;
+
+    qint64 start = floorDiv(fromMs, intervalMs) * intervalMs;
+    const qint64 windowStart = level->oldest() * level->resolutionMs;
+    if (start < windowStart) {
+        start = floorDiv(windowStart + intervalMs - 1, intervalMs) * intervalMs;
+    }
+    if (start >= toMs) return samples;
+
+    const qint64 bucketsPerInterval = intervalMs / level->resolutionMs;
+    samples.reserve(static_cast<int>((toMs - start + intervalMs - 1) / intervalMs));
+
+    qint64 bucket = start / level->resolutionMs;
+    Totals previous = level->total(bucket - 1);
+    for (; start < toMs; start += intervalMs) {
+        bucket += bucketsPerInterval;
+        const Totals current = level->total(bucket - 1);
+
+        Sample sample;
+        sample.startMs = start;
+        sample.packets = current.packets - previous.packets;
+        sample.bytes = current.bytes - previous.bytes;
+        samples.append(sample);
+        previous = current;
+    }
+    return samples;
+}
+
+const RateSeries::Level *RateSeries::levelFor(qint64 fromMs, int intervalMs) const {
+    // Coarsest exact level covering fromMs, else the exact level reaching furthest back
+    const Level *fallback = nullptr;
+    for (int i = ResolutionCount - 1; i >= 0; --i) {
+        const Level &level = m_levels[i];
+        if (level.resolutionMs > intervalMs || intervalMs % level.resolutionMs != 0) continue;
+        if (floorDiv(fromMs, level.resolutionMs) >= level.oldest()) return &level;
+        if (!fallback) fallback = &level;
+    }
+    return fallback;
+}
+
+int RateSeries::Level::index(qint64 bucket) const {
+    const qint64 slot = bucket % capacity;
+    return static_cast<int>(slot < 0 ? slot + capacity : slot);
+}
+
+RateSeries::Totals RateSeries::Level::total(qint64 bucket) const {
+    if (buckets.isEmpty() || bucket < oldest()) return base;
+    return buckets.at(index(bucket > head ? head : bucket));
+}
+
+void RateSeries::Level::add(qint64 bucket, quint64 packets, quint64 bytes) {
+    if (buckets.isEmpty()) {
+        buckets.fill(Totals(), capacity);
+        head = bucket;
+    } else if (bucket > head) {
+        advance(bucket);
+    }
+
+    if (bucket < oldest()) {
+        // Older than the window: counted before it
+        base.packets += packets;
+        base.bytes += bytes;
+        bucket = oldest();
+    }
+
+    // Running totals from this bucket onward include the new counts
+    for (qint64 b = bucket; b <= head; ++b) {
+        Totals &slot = buckets[index(b)];
+        slot.packets += packets;
+        slot.bytes += bytes;
+    }
+}
+
+void RateSeries::Level::advance(qint64 bucket) {
+    // Skipped buckets carry the current total forward, i.e. read as empty
+    const Totals current = buckets.at(index(head));
+    if (bucket - head >= capacity) {
+        base = current;
+        buckets.fill(current);
+    } else {
+        for (qint64 b = head + 1; b <= bucket; ++b) {
+            Totals &slot = buckets[index(b)];
+            base = slot;                          // Total of the evicted bucket b - capacity
+            slot = current;
+        }
+    }
+    head = bucket;
+}
+
+void RateSeries::Level::merge(const Level &other) {
+    if (other.buckets.isEmpty()) return;
+
+    // Running totals add bucket by bucket; total() reads past either head as flat
+    const qint64 newHead = buckets.isEmpty() ? other.head : qMax(head, other.head);
+    const qint64 newOldest = newHead - capacity + 1;
+
+    QVector<Totals> merged(capacity);
+    for (qint64 b = newOldest; b <= newHead; ++b) {
+        const Totals ours = total(b);
+        const Totals theirs = other.total(b);
+        Totals &slot = merged[index(b)];
+        slot.packets = ours.packets + theirs.packets;
+        slot.bytes = ours.bytes + theirs.bytes;
+    }
+
+    const Totals ours = total(newOldest - 1);
+    const Totals theirs = other.total(newOldest - 1);
+    base.packets = ours.packets + theirs.packets;
+    base.bytes = ours.bytes + theirs.bytes;
+    buckets = merged;
+    head = newHead;
+}
@@ -1,33 +1,609 @@
 #include "analysis/StatisticsEngine.h"
+#include "analysis/SymbolTable.h"
+#include "analysis/TcpHeader.h"
 #include <QFile>
+#include <QSaveFile>
+#include <QDataStream>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QJsonArray>
 #include <QTextStream>
 #include <QMutexLocker>
+#include <QTimer>
+#include <QThread>
+#include <QMap>
 #include <algorithm>
+#include <atomic>
+#include <type_traits>
+
+namespace {
+
+// Signals owed to listeners when notifications are coalesced
+enum PendingNotification : quint32 {
+    NotifyStatistics = 0x01,
+    NotifyProtocols  = 0x02,
+    NotifyEndpoints  = 0x04,
+    NotifyRate       = 0x08
+};
+
+// Endpoints tracked for the by-bytes ranking (Space-Saving counters)
+const int EndpointByteRankCapacity = 1024;
+
+// Merge period for per-thread accumulation when no notification interval is set
+const int DefaultMergeIntervalMs = 100;
+
+// Histogram precision: sizes are exact below 2048 bytes, gaps below 256 us
+const int SizePrecision = 11;
+const int InterArrivalPrecision = 8;
+
+// Sketch precision: 0.8% standard error overall, 1.6% per protocol and 6.5%
+// per endpoint, for 16 KB, 4 KB and 256 bytes per sketch
+const int CardinalityPrecision = 14;
+const int ProtocolCardinalityPrecision = 12;
+const int EndpointCardinalityPrecision = 8;
+
+// Alerts held for the next emission; older ones are dropped beyond this
+const int MaxPendingAlerts = 1000;
+
+// Endpoints in each rolling export line
+const int RollingExportTopEndpoints = 10;
+
+// Binary export header: "GSTB" and the layout version
+const quint32 BinaryExportMagic = 0x47535442;
+const quint16 BinaryExportVersion = 1;
+
+std::atomic<quint64> nextInstanceId(1);
+
+void mergeTimeBounds(qint64 &first, qint64 &last, qint64 otherFirst, qint64 otherLast) {
+    if (first == InvalidTimestamp || (otherFirst != InvalidTimestamp && otherFirst < first)) {
+        first = otherFirst;
+    }
+    last = qMax(last, otherLast);                 // InvalidTimestamp sorts first
+}
+
+void mergeProtocolStats(ProtocolStats &into, const ProtocolStats &from) {
+    if (into.packetCount == 0 || from.minPacketSize < into.minPacketSize) {
+        into.minPacketSize = from.minPacketSize;
+    }
+    into.maxPacketSize = qMax(into.maxPacketSize, from.maxPacketSize);
+    into.packetCount += from.packetCount;
+    into.byteCount += from.byteCount;
+    mergeTimeBounds(into.firstSeenUs, into.lastSeenUs, from.firstSeenUs, from.lastSeenUs);
+}
+
+ProtocolStats &protocolEntry(QVector<ProtocolStats> &stats, quint32 protocolId) {
+    if (protocolId >= static_cast<quint32>(stats.size())) {
+        stats.resize(static_cast<int>(protocolId) + 1);
+    }
+    return stats[static_cast<int>(protocolId)];
+}
+
+// Entry for a protocol ID in a per-protocol vector, growing it with copies of empty
+template <typename T>
+T &protocolSlot(QVector<T> &entries, quint32 protocolId, const T &empty) {
+    while (protocolId >= static_cast<quint32>(entries.size())) {
+        entries.append(empty);
+    }
+    return entries[static_cast<int>(protocolId)];
+}
+
+template <typename T>
+void mergeProtocolSlots(QVector<T> &into, const QVector<T> &from, const T &empty) {
+    for (int id = 0; id < from.size(); ++id) {
+        if (from.at(id).isEmpty()) continue;
+        protocolSlot(into, static_cast<quint32>(id), empty).merge(from.at(id));
+    }
+}
+
+// Re-index a per-protocol vector from another engine's protocol IDs (ids: theirs -> ours)
+template <typename T>
+QVector<T> remapProtocolSlots(const QVector<T> &from, const QVector<quint32> &ids, const T &empty) {
+    QVector<T> into;
+    for (int id = 0; id < from.size() && id < ids.size(); ++id) {
+        protocolSlot(into, ids.at(id), empty) = from.at(id);
+    }
+    return into;
+}
+
+Histogram &protocolHistogram(QVector<Histogram> &histograms, quint32 protocolId, int precision) {
+    while (protocolId >= static_cast<quint32>(histograms.size())) {
+        histograms.append(Histogram(precision));
+    }
+    return histograms[static_cast<int>(protocolId)];
+}
+
+void mergeHistograms(QVector<Histogram> &into, const QVector<Histogram> &from, int precision) {
+    for (int id = 0; id < from.size(); ++id) {
+        if (from.at(id).isEmpty()) continue;
+        protocolHistogram(into, static_cast<quint32>(id), precision).merge(from.at(id));
+    }
+}
+
+// Gap since the previous packet of a stream, or -1 for the first one and late packets
+qint64 interArrivalUs(qint64 previousUs, qint64 timeUs) {
+    return (previousUs != InvalidTimestamp && timeUs >= previousUs) ? timeUs - previousUs : -1;
+}
+
+QList<PacketSizeBucket> sizeBuckets(const Histogram &sizes, const QList<quint64> &boundaries) {
+    QList<PacketSizeBucket> buckets;
+    for (int i = 0; i + 1 < boundaries.size(); ++i) {
+        PacketSizeBucket bucket;
+        bucket.minSize = boundaries.at(i);
+        bucket.maxSize = boundaries.at(i + 1);
+        bucket.count = sizes.countBetween(bucket.minSize, bucket.maxSize);
+        bucket.percentage = sizes.isEmpty() ? 0.0 :
+            (static_cast<double>(bucket.count) / sizes.totalCount()) * 100.0;
+        buckets.append(bucket);
+    }
+    return buckets;
+}
+
+PercentileSummary percentileSummary(const Histogram &histogram) {
+    PercentileSummary summary;
+    summary.count = histogram.totalCount();
+    summary.min = histogram.min();
+    summary.max = histogram.max();
+    summary.mean = histogram.mean();
+    summary.p50 = histogram.valueAtPercentile(50.0);
+    summary.p90 = histogram.valueAtPercentile(90.0);
+    summary.p99 = histogram.valueAtPercentile(99.0);
+    summary.p999 = histogram.valueAtPercentile(99.9);
+    return summary;
+}
+
+RateSeries &protocolRates(QVector<RateSeries> &rates, quint32 protocolId) {
+    while (protocolId >= static_cast<quint32>(rates.size())) {
+        rates.append(RateSeries(RateSeries::Compact));
+    }
+    return rates[static_cast<int>(protocolId)];
+}
+
+qint64 intervalStart(qint64 ms, int intervalMs) {
+    const qint64 offset = ms % intervalMs;
+    return ms - (offset < 0 ? offset + intervalMs : offset);
+}
+
+PacketRatePoint ratePoint(const RateSeries::Sample &sample, int intervalMs) {
+    const double intervalSeconds = intervalMs / 1000.0;
+    PacketRatePoint point;
+    point.timestampUs = sample.startMs * 1000;
+    point.packetCount = sample.packets;
+    point.byteCount = sample.bytes;
+    point.packetsPerSecond = sample.packets / intervalSeconds;
+    point.bitsPerSecond = (sample.bytes * 8.0) / intervalSeconds;
+    return point;
+}
+
+QList<PacketRatePoint> ratePoints(const RateSeries &series, const CaptureStatistics &capture,
+                                  int intervalMs) {
+    QList<PacketRatePoint> points;
+    if (intervalMs <= 0 || capture.totalPackets == 0) return points;
+
+    // Completed intervals only; the one holding the newest packet is still open
+    const qint64 fromMs = timestampMs(capture.captureStartUs);
+    const qint64 toMs = intervalStart(timestampMs(capture.captureEndUs), intervalMs);
+    const QVector<RateSeries::Sample> samples = series.resample(fromMs, toMs, intervalMs);
+    points.reserve(samples.size());
+    for (const RateSeries::Sample &sample : samples) {
+        points.append(ratePoint(sample, intervalMs));
+    }
+    return points;
+}
+
+void mergeEndpointStats(EndpointStats &into, const EndpointStats &from) {
+    into.packetsSent += from.packetsSent;
+    into.packetsReceived += from.packetsReceived;
+    into.bytesSent += from.bytesSent;
+    into.bytesReceived += from.bytesReceived;
+    into.totalPackets += from.totalPackets;
+    into.totalBytes += from.totalBytes;
+    into.portsSrc.unite(from.portsSrc);
+    into.portsDst.unite(from.portsDst);
+    mergeTimeBounds(into.firstSeenUs, into.lastSeenUs, from.firstSeenUs, from.lastSeenUs);
+}
+
+// JSON numbers are doubles; counts go through qint64 to pick an overload
+QJsonValue jsonCount(quint64 value) {
+    return static_cast<qint64>(value);
+}
+
+QJsonValue jsonTime(qint64 timeUs) {
+    return timeUs == InvalidTimestamp ? QJsonValue() : QJsonValue(timeUs);
+}
+
+QString csvTime(qint64 timeUs) {
+    return timeUs == InvalidTimestamp ? QString() : QString::number(timeUs);
+}
+
+QString csvField(const QString &value) {
+    if (!value.contains(QLatin1Char(',')) && !value.contains(QLatin1Char('"')) &&
+        !value.contains(QLatin1Char('\n'))) {
+        return value;
+    }
+    QString quoted = value;
+    quoted.replace(QStringLiteral("\""), QStringLiteral("\"\""));
+    return QStringLiteral("\"") + quoted + QStringLiteral("\"");
+}
+
+QJsonObject captureJson(const CaptureStatistics &capture) {
+    QJsonObject object;
+    object["totalPackets"] = jsonCount(capture.totalPackets);
+    object["totalBytes"] = jsonCount(capture.totalBytes);
+    object["droppedPackets"] = jsonCount(capture.droppedPackets);
+    object["captureStartUs"] = jsonTime(capture.captureStartUs);
+    object["captureEndUs"] = jsonTime(capture.captureEndUs);
+    object["durationSeconds"] = capture.captureDuration;
+    object["avgPacketsPerSecond"] = capture.avgPacketsPerSecond;
+    object["avgBitsPerSecond"] = capture.avgBitsPerSecond;
+    object["peakPacketsPerSecond"] = capture.peakPacketsPerSecond;
+    object["peakBitsPerSecond"] = capture.peakBitsPerSecond;
+    object["avgPacketSize"] = capture.avgPacketSize;
+    object["minPacketSize"] = jsonCount(capture.minPacketSize);
+    object["maxPacketSize"] = jsonCount(capture.maxPacketSize);
+    return object;
+}
+
+QJsonObject protocolJson(const ProtocolStats &stats) {
+    QJsonObject object;
+    object["protocol"] = stats.protocol;
+    object["packets"] = jsonCount(stats.packetCount);
+    object["bytes"] = jsonCount(stats.byteCount);
+    object["percentage"] = stats.percentage;
+    object["bytesPercentage"] = stats.bytesPercentage;
+    object["avgPacketSize"] = stats.avgPacketSize;
+    object["minPacketSize"] = jsonCount(stats.minPacketSize);
+    object["maxPacketSize"] = jsonCount(stats.maxPacketSize);
+    object["firstSeenUs"] = jsonTime(stats.firstSeenUs);
+    object["lastSeenUs"] = jsonTime(stats.lastSeenUs);
+    return object;
+}
+
+QStringList sortedProtocols(const EndpointStats &stats) {
+    QStringList protocols = stats.protocols.values();
+    std::sort(protocols.begin(), protocols.end());
+    return protocols;
+}
+
+QJsonObject endpointJson(const EndpointStats &stats) {
+    const QStringList protocols = sortedProtocols(stats);
+
+    QJsonObject object;
+    object["address"] = stats.address;
+    object["packetsSent"] = jsonCount(stats.packetsSent);
+    object["packetsReceived"] = jsonCount(stats.packetsReceived);
+    object["bytesSent"] = jsonCount(stats.bytesSent);
+    object["bytesReceived"] = jsonCount(stats.bytesReceived);
+    object["distinctPeers"] = jsonCount(stats.distinctPeers);
+    object["distinctPortsContacted"] = jsonCount(stats.distinctPortsContacted);
+    object["protocols"] = QJsonArray::fromStringList(protocols);
+    object["firstSeenUs"] = jsonTime(stats.firstSeenUs);
+    object["lastSeenUs"] = jsonTime(stats.lastSeenUs);
+    return object;
+}
+
+QJsonObject rateJson(const PacketRatePoint &point) {
+    QJsonObject object;
+    object["timestampUs"] = jsonTime(point.timestampUs);
+    object["packets"] = jsonCount(point.packetCount);
+    object["bytes"] = jsonCount(point.byteCount);
+    object["packetsPerSecond"] = point.packetsPerSecond;
+    object["bitsPerSecond"] = point.bitsPerSecond;
+    return object;
+}
+
+QJsonObject percentileJson(const PercentileSummary &summary) {
+    QJsonObject object;
+    object["count"] = jsonCount(summary.count);
+    object["min"] = jsonCount(summary.min);
+    object["max"] = jsonCount(summary.max);
+    object["mean"] = summary.mean;
+    object["p50"] = jsonCount(summary.p50);
+    object["p90"] = jsonCount(summary.p90);
+    object["p99"] = jsonCount(summary.p99);
+    object["p999"] = jsonCount(summary.p999);
+    return object;
+}
+
+QJsonObject cardinalityJson(const CardinalityEstimate &estimate) {
+    QJsonObject object;
+    object["sources"] = jsonCount(estimate.sources);
+    object["destinations"] = jsonCount(estimate.destinations);
+    object["sourcePorts"] = jsonCount(estimate.sourcePorts);
+    object["destinationPorts"] = jsonCount(estimate.destinationPorts);
+    object["flows"] = jsonCount(estimate.flows);
+    object["relativeError"] = estimate.relativeError;
+    return object;
+}
+
+QJsonObject cardinalitiesJson(const CardinalityEstimates &estimates) {
+    QJsonObject byProtocol;
+    for (auto it = estimates.byProtocol.constBegin(); it != estimates.byProtocol.constEnd(); ++it) {
+        byProtocol[it.key()] = cardinalityJson(it.value());
+    }
+    QJsonObject object;
+    object["overall"] = cardinalityJson(estimates.overall);
+    object["byProtocol"] = byProtocol;
+    return object;
+}
+
+// Top-level members after the first are written as they are formatted
+void writeJsonMember(QIODevice &out, const char *name, const QJsonObject &object) {
+    out.write(",\n\"");
+    out.write(name);
+    out.write("\":");
+    out.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+}
+
+/**
+ * @brief Streams one top-level JSON array, formatting one element at a time
+ */
+class JsonArrayWriter {
+public:
+    JsonArrayWriter(QIODevice &out, const char *name) : m_out(out), m_first(true) {
+        m_out.write(",\n\"");
+        m_out.write(name);
+        m_out.write("\":[");
+    }
+
+    void append(const QJsonObject &object) {
+        m_out.write(m_first ? "\n" : ",\n");
+        m_out.write(QJsonDocument(object).toJson(QJsonDocument::Compact));
+        m_first = false;
+    }
+
+    void finish() { m_out.write("]"); }
+
+private:
+    QIODevice &m_out;
+    bool m_first;
+};
+
+// Binary export column types
+enum ColumnType : quint8 {
+    UInt64Column = 0,
+    Int64Column = 1,
+    DoubleColumn = 2,
+    StringColumn = 3
+};
+
+inline quint8 columnType(quint64) { return UInt64Column; }
+inline quint8 columnType(qint64) { return Int64Column; }
+inline quint8 columnType(double) { return DoubleColumn; }
+inline quint8 columnType(const QString &) { return StringColumn; }
+
+void writeTableHeader(QDataStream &out, const QString &name, int rows, int columns) {
+    out << name << static_cast<quint32>(rows) << static_cast<quint16>(columns);
+}
+
+// One column: its header, then value(row) for every row
+template <typename Value>
+void writeColumn(QDataStream &out, const QString &name, int rows, Value value) {
+    using Type = typename std::decay<decltype(value(0))>::type;
+    out << name << columnType(Type());
+    for (int row = 0; row < rows; ++row) {
+        out << static_cast<Type>(value(row));
+    }
+}
+
+} // namespace
+
+/**
+ * @brief Statistics gathered privately by one ingest thread
+ *
+ * Built from the engine's own structs so a merge is a field-wise fold.
+ * Rate counts are kept per millisecond and protocol and are folded into the
+ * engine's rate store in time order.
+ */
+struct StatisticsEngine::Accumulator {
+    QMutex mutex;                                 // Owner thread vs. merge; rarely contended
+    SymbolCache protocolIds;                      // Names this batch refers to, held until
+    SymbolCache addressIds;                       // the batch has been folded
+    CaptureStatistics capture;                    // Counts, sizes and start/end only
+    QVector<ProtocolStats> protocols;             // Index: protocol ID
+    QHash<quint32, EndpointRecord> endpoints;     // Key: address ID
+    Histogram sizes;
+    Histogram interArrival;                       // Gaps within this thread's packets
+    QVector<Histogram> protocolSizes;             // Index: protocol ID
+    QVector<Histogram> protocolInterArrival;      // Index: protocol ID
+    CardinalitySketches cardinality;
+    QVector<CardinalitySketches> protocolCardinality; // Index: protocol ID
+    PortCounters srcPorts;
+    PortCounters dstPorts;
+    QMap<QPair<qint64, quint32>, QPair<quint64, quint64>> rates; // (ms, protocol ID) -> (packets, bytes)
+    quint64 errors;
+    QHash<QString, quint64> errorTypes;
+    QList<std::shared_ptr<PacketModel>> errorPackets;
+
+    Accumulator(SymbolTable *protocolNames, SymbolTable *addressNames)
+        : protocolIds(protocolNames), addressIds(addressNames), sizes(SizePrecision),
+          interArrival(InterArrivalPrecision), cardinality(CardinalityPrecision), errors(0) {}
+
+    bool isEmpty() const { return capture.totalPackets == 0; }
+    void add(const std::shared_ptr<PacketModel> &packet, qint64 packetUs, int maxErrorPackets);
+    void swapContents(Accumulator &other);
+};
+
+/**
+ * @brief Read-only view published after each merge
+ */
+struct StatisticsEngine::Snapshot {
+    CaptureStatistics capture;
+    QList<ProtocolStats> protocols;
+    QList<PacketSizeBucket> sizeDistribution;
+    Histogram sizes;                              // Counts implicitly shared with the engine
+    Histogram interArrival;
+    RateSeries rates;                             // Implicitly shared with the engine's store
+};
+
+/**
+ * @brief Engine state copied under the lock for one export
+ *
+ * Every container is implicitly shared with the engine, so taking the copy
+ * is cheap; ingest that continues during the export detaches a container
+ * the first time it changes it and the export still sees the copy.
+ */
+struct StatisticsEngine::ExportSnapshot {
+    CaptureStatistics capture;                    // With the peak rates
+    QList<ProtocolStats> protocols;
+    QHash<quint32, EndpointRecord> endpoints;     // Full exports only
+    QHash<quint32, QString> addresses;            // Names of endpoints, resolved under the lock
+    QList<EndpointStats> topEndpoints;            // Rolling exports only, by bytes
+    RateSeries rates;
+    int intervalMs;
+    PacketRatePoint lastRate;
+    QList<PacketSizeBucket> sizeDistribution;
+    Histogram sizes;
+    Histogram interArrival;
+    CardinalitySketches cardinality;
+    QVector<CardinalitySketches> protocolCardinality;
+    PortCounters srcPorts;
+    PortCounters dstPorts;
+    quint64 errors;
+    QHash<QString, quint64> errorTypes;
+
+    ExportSnapshot() : intervalMs(0), errors(0) {}
+};
+
+void StatisticsEngine::Accumulator::add(const std::shared_ptr<PacketModel> &packet,
+                                        qint64 packetUs, int maxErrorPackets) {
+    const PacketModel &p = *packet;
+    const qint64 timeUs = packetUs != InvalidTimestamp ? packetUs : capture.captureEndUs;
+    const qint64 gapUs = interArrivalUs(capture.captureEndUs, packetUs);
+    if (gapUs >= 0) interArrival.record(static_cast<quint64>(gapUs));
+    if (capture.totalPackets == 0 || p.length < capture.minPacketSize) {
+        capture.minPacketSize = p.length;
+    }
+    capture.maxPacketSize = qMax<quint64>(capture.maxPacketSize, p.length);
+    capture.totalPackets++;
+    capture.totalBytes += p.length;
+    mergeTimeBounds(capture.captureStartUs, capture.captureEndUs, timeUs, timeUs);
+
+    const Symbol protocol = protocolIds.intern(p.protocol);
+    const quint32 protocolId = protocol.id;
+    ProtocolStats &proto = protocolEntry(protocols, protocolId);
+    if (proto.packetCount == 0) {
+        proto.protocol = p.protocol;
+        proto.minPacketSize = p.length;
+    }
+    const qint64 protocolGapUs = interArrivalUs(proto.lastSeenUs, packetUs);
+    if (protocolGapUs >= 0) {
+        protocolHistogram(protocolInterArrival, protocolId, InterArrivalPrecision)
+            .record(static_cast<quint64>(protocolGapUs));
+    }
+    protocolHistogram(protocolSizes, protocolId, SizePrecision).record(p.length);
+    proto.packetCount++;
+    proto.byteCount += p.length;
+    proto.minPacketSize = qMin<quint64>(proto.minPacketSize, p.length);
+    proto.maxPacketSize = qMax<quint64>(proto.maxPacketSize, p.length);
+    mergeTimeBounds(proto.firstSeenUs, proto.lastSeenUs, timeUs, timeUs);
+
+    const Symbol srcAddress = addressIds.intern(p.srcIP);
+    const Symbol dstAddress = addressIds.intern(p.dstIP);
+    if (srcAddress.id != SymbolTable::EmptyId) {
+        EndpointRecord &record = endpoints[srcAddress.id];
+        EndpointStats &src = record.stats;
+        src.packetsSent++;
+        src.bytesSent += p.length;
+        src.totalPackets++;
+        src.totalBytes += p.length;
+        src.portsSrc.insert(p.srcPort);
+        record.protocolIds.insert(protocolId);
+        if (dstAddress.id != SymbolTable::EmptyId) record.peers.addKey(dstAddress.key);
+        if (p.dstPort > 0) record.portsContacted.addKey(p.dstPort);
+        mergeTimeBounds(src.firstSeenUs, src.lastSeenUs, timeUs, timeUs);
+    }
+    if (dstAddress.id != SymbolTable::EmptyId) {
+        EndpointRecord &record = endpoints[dstAddress.id];
+        EndpointStats &dst = record.stats;
+        dst.packetsReceived++;
+        dst.bytesReceived += p.length;
+        dst.totalPackets++;
+        dst.totalBytes += p.length;
+        dst.portsDst.insert(p.dstPort);
+        record.protocolIds.insert(protocolId);
+        if (srcAddress.id != SymbolTable::EmptyId) record.peers.addKey(srcAddress.key);
+        mergeTimeBounds(dst.firstSeenUs, dst.lastSeenUs, timeUs, timeUs);
+    }
+    cardinality.add(p, protocol, srcAddress, dstAddress);
+    protocolSlot(protocolCardinality, protocolId, CardinalitySketches(ProtocolCardinalityPrecision))
+        .add(p, protocol, srcAddress, dstAddress);
+
+    sizes.record(p.length);
+    if (p.srcPort > 0) srcPorts.increment(p.srcPort);
+    if (p.dstPort > 0) dstPorts.increment(p.dstPort);
+
+    if (timeUs != InvalidTimestamp) {
+        QPair<quint64, quint64> &rate = rates[qMakePair(timestampMs(timeUs), protocolId)];
+        rate.first++;
+        rate.second += p.length;
+    }
+
+    if (p.hasError) {
+        errors++;
+        errorTypes[p.errorInfo.isEmpty() ? QStringLiteral("Unknown") : p.errorInfo]++;
+        if (errorPackets.size() < maxErrorPackets) {
+            errorPackets.append(packet);
+        }
+    }
+}
+
+void StatisticsEngine::Accumulator::swapContents(Accumulator &other) {
+    protocolIds.swap(other.protocolIds);
+    addressIds.swap(other.addressIds);
+    std::swap(capture, other.capture);
+    protocols.swap(other.protocols);
+    endpoints.swap(other.endpoints);
+    std::swap(sizes, other.sizes);
+    std::swap(interArrival, other.interArrival);
+    protocolSizes.swap(other.protocolSizes);
+    protocolInterArrival.swap(other.protocolInterArrival);
+    std::swap(cardinality, other.cardinality);
+    protocolCardinality.swap(other.protocolCardinality);
+    srcPorts.swap(other.srcPorts);
+    dstPorts.swap(other.dstPorts);
+    rates.swap(other.rates);
+    std::swap(errors, other.errors);
+    errorTypes.swap(other.errorTypes);
+    errorPackets.swap(other.errorPackets);
+}
 
 StatisticsEngine::StatisticsEngine(QObject *parent)
     : QObject(parent)
+    , m_protocolIds(&m_protocolNames)
+    , m_addressIds(&m_addressNames)
+    , m_lastPacketTimeUs(InvalidTimestamp)
+    , m_endpointByteRank(EndpointByteRankCapacity)
     , m_maxEndpoints(10000)
     , m_timeSeriesInterval(1000)
+    , m_currentIntervalStartMs(-1)
     , m_currentIntervalPackets(0)
     , m_currentIntervalBytes(0)
+    , m_sizeHistogram(SizePrecision)
+    , m_interArrival(InterArrivalPrecision)
+    , m_cardinality(CardinalityPrecision)
+    , m_anomalyDetection(true)
+    , m_tcpProtocolId(m_protocolIds.intern(QStringLiteral("TCP")).id)
     , m_totalErrors(0)
     , m_maxErrorPackets(1000)
     , m_peakPacketsPerSecond(0.0)
     , m_peakBitsPerSecond(0.0)
+    , m_notifyTimer(new QTimer(this))
+    , m_notifyIntervalMs(0)
+    , m_pendingNotifications(0)
+    , m_rollingTimer(new QTimer(this))
+    , m_generation(0)
+    , m_protocolSnapshotGeneration(UINT64_MAX)
+    , m_sizeSnapshotGeneration(UINT64_MAX)
+    , m_perThreadAccumulation(false)
+    , m_instanceId(nextInstanceId++)
+    , m_snapshot(std::make_shared<Snapshot>())
 {
+    qRegisterMetaType<AnomalyAlert>();
+    connect(m_notifyTimer, &QTimer::timeout, this, &StatisticsEngine::publishPendingUpdates);
+    connect(m_rollingTimer, &QTimer::timeout, this, &StatisticsEngine::writeRollingExport);
+
     // Default packet size buckets: 0-64, 64-128, 128-256, 256-512, 512-1024, 1024-1518, 1518+
     m_sizeBucketBoundaries = {0, 64, 128, 256, 512, 1024, 1518, UINT64_MAX};
-    
-    // Initialize size distribution buckets
-    for (int i = 0; i < m_sizeBucketBoundaries.size() - 1; ++i) {
-        PacketSizeBucket bucket;
-        bucket.minSize = m_sizeBucketBoundaries[i];
-        bucket.maxSize = m_sizeBucketBoundaries[i + 1];
-        m_sizeDistribution.append(bucket);
-    }
 }
 
 StatisticsEngine::~StatisticsEngine() {
@@ -37,19 +613,543 @@ StatisticsEngine::~StatisticsEngine() {
 void StatisticsEngine::addPacket(const std::shared_ptr<PacketModel> &packet) {
     if (!packet) return;
 
-    QMutexLocker locker(&m_mutex);
+    if (m_perThreadAccumulation) {
+        Accumulator &accumulator = localAccumulator();
+        QMutexLocker locker(&accumulator.mutex);
+        // Re-checked under the accumulator's lock, which the final merge of
+        // setPerThreadAccumulation(false) takes after clearing the flag
+        if (m_perThreadAccumulation) {
+            accumulator.add(packet, packetTimestampUs(*packet), m_maxErrorPackets);
+            return;
+        }
+    }
+
+    bool rateChanged = false;
+    PacketRatePoint ratePoint;
+    QList<AnomalyAlert> alerts;
+    {
+        QMutexLocker locker(&m_mutex);
+        rateChanged = processPacket(packet, packetTimestampUs(*packet));
+        updateDerivedStatistics();
+        if (rateChanged) {
+            ratePoint = m_lastRate;
+        }
+        if (m_notifyIntervalMs > 0) {
+            queueNotifications(rateChanged);
+            return;
+        }
+        alerts.swap(m_pendingAlerts);
+    }
+
+    emitAlerts(alerts);
+    emit protocolStatsUpdated();
+    emit endpointStatsUpdated();
+    if (rateChanged) {
+        emit rateUpdated(ratePoint.packetsPerSecond, ratePoint.bitsPerSecond);
+    }
+    emit statisticsUpdated();
+}
+
+void StatisticsEngine::addPackets(const QList<std::shared_ptr<PacketModel>> &packets,
+                                  const QVector<qint64> &timestampsUs) {
+    if (packets.isEmpty()) return;
+
+    if (m_perThreadAccumulation) {
+        Accumulator &accumulator = localAccumulator();
+        QMutexLocker locker(&accumulator.mutex);
+        if (m_perThreadAccumulation) {  // See addPacket()
+            for (int i = 0; i < packets.size(); ++i) {
+                const auto &packet = packets.at(i);
+                if (packet) {
+                    accumulator.add(packet, batchTimestampUs(*packet, timestampsUs, i),
+                                    m_maxErrorPackets);
+                }
+            }
+            return;
+        }
+    }
+
+    bool rateChanged = false;
+    PacketRatePoint ratePoint;
+    QList<AnomalyAlert> alerts;
+    {
+        QMutexLocker locker(&m_mutex);
+        for (int i = 0; i < packets.size(); ++i) {
+            const auto &packet = packets.at(i);
+            if (packet) {
+                rateChanged |= processPacket(packet, batchTimestampUs(*packet, timestampsUs, i));
+            }
+        }
+        updateDerivedStatistics();
+        if (rateChanged) {
+            ratePoint = m_lastRate;
+        }
+        if (m_notifyIntervalMs > 0) {
+            queueNotifications(rateChanged);
+            return;
+        }
+        alerts.swap(m_pendingAlerts);
+    }
+
+    // One notification per batch instead of per packet
+    emitAlerts(alerts);
+    emit protocolStatsUpdated();
+    emit endpointStatsUpdated();
+    if (rateChanged) {
+        emit rateUpdated(ratePoint.packetsPerSecond, ratePoint.bitsPerSecond);
+    }
+    emit statisticsUpdated();
+}
+
+void StatisticsEngine::queueNotifications(bool rateChanged) {
+    m_pendingNotifications |= NotifyStatistics | NotifyProtocols | NotifyEndpoints;
+    if (rateChanged) {
+        m_pendingNotifications |= NotifyRate;
+        m_pendingRate = m_lastRate;
+    }
+}
+
+void StatisticsEngine::publishPendingUpdates() {
+    if (m_perThreadAccumulation) {
+        mergeAccumulators();
+    }
+
+    quint32 pending = 0;
+    PacketRatePoint ratePoint;
+    QList<AnomalyAlert> alerts;
+    {
+        QMutexLocker locker(&m_mutex);
+        pending = m_pendingNotifications;
+        ratePoint = m_pendingRate;
+        m_pendingNotifications = 0;
+        alerts.swap(m_pendingAlerts);
+    }
+
+    // Emitted from the timer's thread, outside the lock
+    emitAlerts(alerts);
+    if (pending & NotifyProtocols) {
+        emit protocolStatsUpdated();
+    }
+    if (pending & NotifyEndpoints) {
+        emit endpointStatsUpdated();
+    }
+    if (pending & NotifyRate) {
+        emit rateUpdated(ratePoint.packetsPerSecond, ratePoint.bitsPerSecond);
+    }
+    if (pending & NotifyStatistics) {
+        emit statisticsUpdated();
+    }
+}
+
+StatisticsEngine::Accumulator &StatisticsEngine::localAccumulator() {
+    // One-entry cache per thread, keyed by engine id rather than address so
+    // an entry left by a destroyed engine is never reused
+    thread_local quint64 cachedEngineId = 0;
+    thread_local Accumulator *cachedAccumulator = nullptr;
+    if (cachedEngineId == m_instanceId) {
+        return *cachedAccumulator;
+    }
+
+    QMutexLocker locker(&m_accumulatorsMutex);
+    std::shared_ptr<Accumulator> &accumulator = m_accumulators[QThread::currentThread()];
+    if (!accumulator) {
+        accumulator = std::make_shared<Accumulator>(&m_protocolNames, &m_addressNames);
+    }
+    cachedEngineId = m_instanceId;
+    cachedAccumulator = accumulator.get();
+    return *accumulator;
+}
+
+void StatisticsEngine::flushAccumulators() {
+    mergeAccumulators();
+}
+
+void StatisticsEngine::mergeAccumulators() {
+    QList<std::shared_ptr<Accumulator>> accumulators;
+    {
+        QMutexLocker locker(&m_accumulatorsMutex);
+        accumulators = m_accumulators.values();
+    }
+
+    bool merged = false;
+    bool rateChanged = false;
+    for (const auto &accumulator : accumulators) {
+        // Writers are only held up for the swap, never for the fold. The batch
+        // takes the accumulator's names with it and releases them once folded
+        Accumulator batch(&m_protocolNames, &m_addressNames);
+        {
+            QMutexLocker locker(&accumulator->mutex);
+            if (accumulator->isEmpty()) continue;
+            batch.swapContents(*accumulator);
+        }
+
+        QMutexLocker locker(&m_mutex);
+        rateChanged |= foldAccumulator(batch);
+        merged = true;
+    }
+
+    if (!merged) return;
+
+    QMutexLocker locker(&m_mutex);
+    updateDerivedStatistics();
+    queueNotifications(rateChanged);
+    publishSnapshot();
+}
+
+bool StatisticsEngine::foldAccumulator(const Accumulator &batch) {
+    m_generation++;
+
+    // Overall statistics
+    const CaptureStatistics &capture = batch.capture;
+    if (m_captureStats.totalPackets == 0 || capture.minPacketSize < m_captureStats.minPacketSize) {
+        m_captureStats.minPacketSize = capture.minPacketSize;
+    }
+    m_captureStats.maxPacketSize = qMax(m_captureStats.maxPacketSize, capture.maxPacketSize);
+    m_captureStats.totalPackets += capture.totalPackets;
+    m_captureStats.totalBytes += capture.totalBytes;
+    // The gap across the batch boundary belongs to no thread's stream
+    m_interArrival.merge(batch.interArrival);
+    mergeTimeBounds(m_captureStats.captureStartUs, m_captureStats.captureEndUs,
+                    capture.captureStartUs, capture.captureEndUs);
+    m_lastPacketTimeUs = m_captureStats.captureEndUs;
+
+    // The batch still holds its names, so the engine's caches resolve them to
+    // the same IDs and take over the references
+    for (int id = 0; id < batch.protocols.size(); ++id) {
+        const ProtocolStats &from = batch.protocols.at(id);
+        if (from.packetCount == 0) continue;
+        ProtocolStats &into = protocolEntry(m_protocolStats, static_cast<quint32>(id));
+        if (into.packetCount == 0) {
+            m_protocolIds.intern(from.protocol);
+            into = from;
+        } else {
+            mergeProtocolStats(into, from);
+        }
+    }
+
+    for (auto it = batch.endpoints.constBegin(); it != batch.endpoints.constEnd(); ++it) {
+        auto existing = m_endpointStats.find(it.key());
+        if (existing == m_endpointStats.end()) {
+            m_addressIds.intern(m_addressNames.name(it.key()));
+            m_endpointStats.insert(it.key(), it.value());
+        } else {
+            existing.value().merge(it.value());
+        }
+        m_endpointRank.add(it.key(), it.value().stats.totalPackets);
+        m_endpointByteRank.add(it.key(), it.value().stats.totalBytes);
+    }
+    if (m_endpointStats.size() > m_maxEndpoints) {
+        enforceEndpointLimit();
+    }
+
+    m_sizeHistogram.merge(batch.sizes);
+    mergeHistograms(m_protocolSizes, batch.protocolSizes, SizePrecision);
+    mergeHistograms(m_protocolInterArrival, batch.protocolInterArrival, InterArrivalPrecision);
+    m_cardinality.merge(batch.cardinality);
+    mergeProtocolSlots(m_protocolCardinality, batch.protocolCardinality,
+                       CardinalitySketches(ProtocolCardinalityPrecision));
+
+    m_srcPortStats.merge(batch.srcPorts);
+    m_dstPortStats.merge(batch.dstPorts);
+
+    // Rate counts land in their millisecond; peaks are re-read per touched interval
+    QVector<qint64> touchedIntervals;
+    for (auto it = batch.rates.constBegin(); it != batch.rates.constEnd(); ++it) {
+        const qint64 ms = it.key().first;
+        m_rateSeries.add(ms, it.value().first, it.value().second);
+        protocolRates(m_protocolRates, it.key().second).add(ms, it.value().first, it.value().second);
+
+        const qint64 start = intervalStart(ms, m_timeSeriesInterval);
+        if (touchedIntervals.isEmpty() || touchedIntervals.last() != start) {
+            touchedIntervals.append(start);
+        }
+    }
+    for (qint64 start : touchedIntervals) {
+        const auto samples = m_rateSeries.resample(start, start + m_timeSeriesInterval, m_timeSeriesInterval);
+        if (samples.isEmpty()) continue;
+        const PacketRatePoint point = ratePoint(samples.first(), m_timeSeriesInterval);
+        m_peakPacketsPerSecond = qMax(m_peakPacketsPerSecond, point.packetsPerSecond);
+        m_peakBitsPerSecond = qMax(m_peakBitsPerSecond, point.bitsPerSecond);
+        if (point.timestampUs >= m_lastRate.timestampUs) {
+            m_lastRate = point;
+        }
+    }
+
+    m_totalErrors += batch.errors;
+    for (auto it = batch.errorTypes.constBegin(); it != batch.errorTypes.constEnd(); ++it) {
+        m_errorTypes[it.key()] += it.value();
+    }
+    for (const auto &packet : batch.errorPackets) {
+        if (m_errorPackets.size() >= m_maxErrorPackets) break;
+        m_errorPackets.append(packet);
+    }
+
+    return !touchedIntervals.isEmpty();
+}
+
+void StatisticsEngine::merge(const StatisticsEngine &other) {
+    if (&other == this) return;
+
+    // Copied under the other engine's lock; the containers are implicitly shared
+    CaptureStatistics capture;
+    QVector<ProtocolStats> protocols;
+    QHash<quint32, EndpointRecord> endpoints;
+    Histogram sizes;
+    Histogram interArrival;
+    QVector<Histogram> protocolSizes;
+    QVector<Histogram> protocolInterArrival;
+    CardinalitySketches cardinality;
+    QVector<CardinalitySketches> protocolCardinality;
+    PortCounters srcPorts;
+    PortCounters dstPorts;
+    RateSeries rates;
+    QVector<RateSeries> protocolRateSeries;
+    quint64 errors = 0;
+    QHash<QString, quint64> errorTypes;
+    QList<std::shared_ptr<PacketModel>> errorPackets;
+    double peakPackets = 0.0;
+    double peakBits = 0.0;
+    QVector<QString> protocolNames;               // Index: the other engine's protocol ID
+    QHash<quint32, QString> addresses;            // Key: the other engine's address ID
+    {
+        QMutexLocker locker(&other.m_mutex);
+        capture = other.m_captureStats;
+        protocols = other.m_protocolStats;
+        endpoints = other.m_endpointStats;
+        sizes = other.m_sizeHistogram;
+        interArrival = other.m_interArrival;
+        protocolSizes = other.m_protocolSizes;
+        protocolInterArrival = other.m_protocolInterArrival;
+        cardinality = other.m_cardinality;
+        protocolCardinality = other.m_protocolCardinality;
+        srcPorts = other.m_srcPortStats;
+        dstPorts = other.m_dstPortStats;
+        rates = other.m_rateSeries;
+        protocolRateSeries = other.m_protocolRates;
+        errors = other.m_totalErrors;
+        errorTypes = other.m_errorTypes;
+        errorPackets = other.m_errorPackets;
+        peakPackets = other.m_peakPacketsPerSecond;
+        peakBits = other.m_peakBitsPerSecond;
+
+        // IDs are per engine, so the names travel with the state
+        const int protocolCount = qMax(qMax(qMax(protocols.size(), protocolSizes.size()),
+                                            qMax(protocolInterArrival.size(),
+                                                 protocolCardinality.size())),
+                                       protocolRateSeries.size());
+        protocolNames.reserve(protocolCount);
+        for (int id = 0; id < protocolCount; ++id) {
+            protocolNames.append(other.m_protocolNames.name(static_cast<quint32>(id)));
+        }
+        addresses.reserve(endpoints.size());
+        for (auto it = endpoints.constBegin(); it != endpoints.constEnd(); ++it) {
+            addresses.insert(it.key(), other.m_addressNames.name(it.key()));
+        }
+    }
+    if (capture.totalPackets == 0) return;
+
+    bool rateChanged = false;
+    PacketRatePoint lastRate;
+    {
+        QMutexLocker locker(&m_mutex);
+        m_generation++;
+
+        // Overall statistics
+        if (m_captureStats.totalPackets == 0 || capture.minPacketSize < m_captureStats.minPacketSize) {
+            m_captureStats.minPacketSize = capture.minPacketSize;
+        }
+        m_captureStats.maxPacketSize = qMax(m_captureStats.maxPacketSize, capture.maxPacketSize);
+        m_captureStats.totalPackets += capture.totalPackets;
+        m_captureStats.totalBytes += capture.totalBytes;
+        m_captureStats.displayedPackets += capture.displayedPackets;
+        m_captureStats.displayedBytes += capture.displayedBytes;
+        m_captureStats.markedPackets += capture.markedPackets;
+        m_captureStats.droppedPackets += capture.droppedPackets;
+        mergeTimeBounds(m_captureStats.captureStartUs, m_captureStats.captureEndUs,
+                        capture.captureStartUs, capture.captureEndUs);
+        m_lastPacketTimeUs = m_captureStats.captureEndUs;
+
+        // Re-keyed onto this engine's tables, whose caches then hold the names
+        QVector<quint32> protocolIds;             // Index: the other engine's protocol ID
+        protocolIds.reserve(protocolNames.size());
+        for (const QString &name : protocolNames) {
+            protocolIds.append(m_protocolIds.intern(name).id);
+        }
+
+        for (int id = 0; id < protocols.size(); ++id) {
+            const ProtocolStats &from = protocols.at(id);
+            if (from.packetCount == 0) continue;
+            ProtocolStats &into = protocolEntry(m_protocolStats, protocolIds.at(id));
+            if (into.packetCount == 0) {
+                into = from;
+            } else {
+                mergeProtocolStats(into, from);
+            }
+        }
+
+        // Rankings are re-seeded from the merged totals
+        for (auto it = endpoints.constBegin(); it != endpoints.constEnd(); ++it) {
+            const quint32 addressId = m_addressIds.intern(addresses.value(it.key())).id;
+            EndpointRecord from = it.value();
+            from.protocolIds.clear();
+            for (quint32 protocolId : it.value().protocolIds) {
+                from.protocolIds.insert(protocolIds.value(static_cast<int>(protocolId)));
+            }
+            m_endpointStats[addressId].merge(from);
+            m_endpointRank.add(addressId, from.stats.totalPackets);
+            m_endpointByteRank.add(addressId, from.stats.totalBytes);
+        }
+        if (m_endpointStats.size() > m_maxEndpoints) {
+            enforceEndpointLimit();
+        }
+
+        m_sizeHistogram.merge(sizes);
+        m_interArrival.merge(interArrival);
+        mergeHistograms(m_protocolSizes,
+                        remapProtocolSlots(protocolSizes, protocolIds, Histogram(SizePrecision)),
+                        SizePrecision);
+        mergeHistograms(m_protocolInterArrival,
+                        remapProtocolSlots(protocolInterArrival, protocolIds,
+                                           Histogram(InterArrivalPrecision)),
+                        InterArrivalPrecision);
+        m_cardinality.merge(cardinality);
+        const CardinalitySketches emptySketches(ProtocolCardinalityPrecision);
+        mergeProtocolSlots(m_protocolCardinality,
+                           remapProtocolSlots(protocolCardinality, protocolIds, emptySketches),
+                           emptySketches);
+
+        m_srcPortStats.merge(srcPorts);
+        m_dstPortStats.merge(dstPorts);
+
+        m_rateSeries.merge(rates);
+        for (int id = 0; id < protocolRateSeries.size(); ++id) {
+            if (protocolRateSeries.at(id).isEmpty()) continue;
+            protocolRates(m_protocolRates, protocolIds.at(id)).merge(protocolRateSeries.at(id));
+        }
+
+        // Intervals split between the engines only reach their true rate once summed
+        m_peakPacketsPerSecond = qMax(m_peakPacketsPerSecond, peakPackets);
+        m_peakBitsPerSecond = qMax(m_peakBitsPerSecond, peakBits);
+        for (const PacketRatePoint &point : ratePoints(m_rateSeries, m_captureStats, m_timeSeriesInterval)) {
+            m_peakPacketsPerSecond = qMax(m_peakPacketsPerSecond, point.packetsPerSecond);
+            m_peakBitsPerSecond = qMax(m_peakBitsPerSecond, point.bitsPerSecond);
+        }
+
+        // The open interval and the last completed one are re-read from the merged series
+        const qint64 start = intervalStart(timestampMs(m_captureStats.captureEndUs), m_timeSeriesInterval);
+        const auto samples = m_rateSeries.resample(start - m_timeSeriesInterval,
+                                                   start + m_timeSeriesInterval, m_timeSeriesInterval);
+        m_currentIntervalStartMs = start;
+        m_currentIntervalPackets = 0;
+        m_currentIntervalBytes = 0;
+        for (const RateSeries::Sample &sample : samples) {
+            if (sample.startMs == start) {
+                m_currentIntervalPackets = sample.packets;
+                m_currentIntervalBytes = sample.bytes;
+            } else if (m_captureStats.captureStartUs < start * 1000) {
+                m_lastRate = ratePoint(sample, m_timeSeriesInterval);
+                rateChanged = true;
+            }
+        }
+
+        m_totalErrors += errors;
+        for (auto it = errorTypes.constBegin(); it != errorTypes.constEnd(); ++it) {
+            m_errorTypes[it.key()] += it.value();
+        }
+        for (const auto &packet : errorPackets) {
+            if (m_errorPackets.size() >= m_maxErrorPackets) break;
+            m_errorPackets.append(packet);
+        }
+
+        updateDerivedStatistics();
+        lastRate = m_lastRate;
+        if (m_perThreadAccumulation) {
+            publishSnapshot();
+        }
+        if (m_notifyIntervalMs > 0 || m_perThreadAccumulation) {
+            queueNotifications(rateChanged);
+            return;
+        }
+    }
+
+    emit protocolStatsUpdated();
+    emit endpointStatsUpdated();
+    if (rateChanged) {
+        emit rateUpdated(lastRate.packetsPerSecond, lastRate.bitsPerSecond);
+    }
+    emit statisticsUpdated();
+}
+
+void StatisticsEngine::publishSnapshot() {
+    auto snapshot = std::make_shared<Snapshot>();
+    snapshot->capture = m_captureStats;
+    snapshot->capture.peakPacketsPerSecond = m_peakPacketsPerSecond;
+    snapshot->capture.peakBitsPerSecond = m_peakBitsPerSecond;
+    snapshot->protocols = protocolSnapshot();
+    snapshot->sizeDistribution = sizeDistributionSnapshot();
+    snapshot->sizes = m_sizeHistogram;
+    snapshot->interArrival = m_interArrival;
+    snapshot->rates = m_rateSeries;
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::move(snapshot)));
+}
+
+void StatisticsEngine::setAnomalyDetection(bool enable) {
+    QMutexLocker locker(&m_mutex);
+    m_anomalyDetection = enable;
+}
+
+void StatisticsEngine::setAnomalySettings(const AnomalyDetector::Settings &settings) {
+    QMutexLocker locker(&m_mutex);
+    m_detector.setSettings(settings);
+}
+
+void StatisticsEngine::setPerThreadAccumulation(bool enable) {
+    if (m_perThreadAccumulation == enable) return;
+
+    // Cleared before the final merge: a writer that still saw the flag set
+    // either added under its accumulator's lock before the merge swapped the
+    // accumulator out, or re-checks the flag under that lock and takes the
+    // locking path
+    m_perThreadAccumulation = enable;
+    if (!enable) {
+        mergeAccumulators();
+    }
+
+    // Accumulators are merged on the notification timer
+    if (m_notifyIntervalMs == 0) {
+        if (enable) {
+            m_notifyTimer->start(DefaultMergeIntervalMs);
+        } else {
+            m_notifyTimer->stop();
+            publishPendingUpdates();
+        }
+    }
+}
+
+bool StatisticsEngine::processPacket(const std::shared_ptr<PacketModel> &packet, qint64 packetUs) {
+    // Invalidates the cached percentage snapshots
+    m_generation++;
+
+    // Everything below works on integer microseconds. A packet without a
+    // valid capture time takes the previous packet's, and before the first
+    // timed packet it is counted but not placed in time
+    const qint64 timeUs = packetUs != InvalidTimestamp ? packetUs : m_lastPacketTimeUs;
+    const bool timed = timeUs != InvalidTimestamp;
+
+    // Gaps are only measured between packets that carry their own time
+    const qint64 previousUs = packetUs != InvalidTimestamp ? m_lastPacketTimeUs : InvalidTimestamp;
 
     // Update overall statistics
     m_captureStats.totalPackets++;
     m_captureStats.totalBytes += packet->length;
 
-    if (m_captureStats.captureStart.isNull()) {
-        m_captureStats.captureStart = packet->timestamp;
-        m_currentIntervalStart = packet->timestamp;
+    if (timed) {
+        if (m_captureStats.captureStartUs == InvalidTimestamp) {
+            m_captureStats.captureStartUs = timeUs;
+        }
+        m_captureStats.captureEndUs = timeUs;
+        m_lastPacketTimeUs = timeUs;
     }
-    
-    m_captureStats.captureEnd = packet->timestamp;
-    m_lastPacketTime = packet->timestamp;
 
     // Update min/max packet sizes
     if (m_captureStats.minPacketSize == 0 || packet->length < m_captureStats.minPacketSize) {
@@ -59,21 +1159,50 @@ void StatisticsEngine::addPacket(const std::shared_ptr<PacketModel> &packet) {
         m_captureStats.maxPacketSize = packet->length;
     }
 
+    // Resolve names once through the engine's caches; the component updates
+    // key on the IDs and the sketches on the keys
+    const Symbol protocol = m_protocolIds.intern(packet->protocol);
+    const Symbol src = m_addressIds.intern(packet->srcIP);
+    const Symbol dst = m_addressIds.intern(packet->dstIP);
+    const quint32 protocolId = protocol.id;
+
+    // Score the interval this packet closes before counting the packet in the
+    // next one; the empty intervals it skipped over are folded in after it
+    if (m_anomalyDetection && timed && m_currentIntervalStartMs >= 0) {
+        const qint64 startMs = intervalStart(timestampMs(timeUs), m_timeSeriesInterval);
+        if (startMs > m_currentIntervalStartMs) {
+            detectAnomalies(m_currentIntervalStartMs, m_currentIntervalPackets,
+                            (startMs - m_currentIntervalStartMs) / m_timeSeriesInterval - 1);
+        }
+    }
+
     // Update component statistics
-    updateProtocolStats(packet);
-    updateEndpointStats(packet);
-    updateTimeSeries(packet);
-    updateSizeDistribution(packet);
+    // Read in place; value() would copy the whole ProtocolStats per packet
+    const qint64 protocolPreviousUs =
+        packetUs != InvalidTimestamp && protocolId < static_cast<quint32>(m_protocolStats.size()) ?
+        m_protocolStats.at(static_cast<int>(protocolId)).lastSeenUs : InvalidTimestamp;
+    updateProtocolStats(packet, protocolId, timeUs);
+    updateEndpointStats(packet, protocolId, src, dst, timeUs);
+    const bool intervalClosed = timed && updateTimeSeries(packet, protocolId, timeUs);
+    updateDistributions(packet, protocolId, timeUs, previousUs, protocolPreviousUs);
+    updateCardinality(packet, protocol, src, dst);
     updatePortStats(packet);
+    if (m_anomalyDetection) {
+        updateDetectionCounters(packet, protocolId, src.id, dst.id);
+    }
 
     // Track errors
     if (packet->hasError) {
         trackError(packet);
     }
 
+    return intervalClosed;
+}
+
+void StatisticsEngine::updateDerivedStatistics() {
     // Calculate derived statistics
-    m_captureStats.captureDuration = 
-        m_captureStats.captureStart.msecsTo(m_captureStats.captureEnd) / 1000.0;
+    m_captureStats.captureDuration = (m_captureStats.totalPackets > 0) ?
+        (m_captureStats.captureEndUs - m_captureStats.captureStartUs) / 1000000.0 : 0.0;
     
     if (m_captureStats.captureDuration > 0) {
         m_captureStats.avgPacketsPerSecond = 
@@ -87,17 +1216,32 @@ void StatisticsEngine::addPacket(const std::shared_ptr<PacketModel> &packet) {
         m_captureStats.avgPacketSize = 
             static_cast<double>(m_captureStats.totalBytes) / m_captureStats.totalPackets;
     }
-
-    emit statisticsUpdated();
 }
 
 void StatisticsEngine::clear() {
     QMutexLocker locker(&m_mutex);
+
+    {
+        QMutexLocker registryLocker(&m_accumulatorsMutex);
+        for (const auto &accumulator : m_accumulators) {
+            Accumulator empty(&m_protocolNames, &m_addressNames);
+            QMutexLocker accumulatorLocker(&accumulator->mutex);
+            accumulator->swapContents(empty);
+        }
+    }
     
     m_captureStats = CaptureStatistics();
+    m_lastPacketTimeUs = InvalidTimestamp;
     m_protocolStats.clear();
     m_endpointStats.clear();
-    m_timeSeriesData.clear();
+    m_endpointRank.clear();
+    m_endpointByteRank.clear();
+    m_rateSeries.clear();
+    m_protocolRates.clear();
+    m_currentIntervalStartMs = -1;
+    m_currentIntervalPackets = 0;
+    m_currentIntervalBytes = 0;
+    m_lastRate = PacketRatePoint();
     m_srcPortStats.clear();
     m_dstPortStats.clear();
     m_errorPackets.clear();
@@ -105,33 +1249,47 @@ void StatisticsEngine::clear() {
     m_totalErrors = 0;
     m_peakPacketsPerSecond = 0.0;
     m_peakBitsPerSecond = 0.0;
-    
-    // Reset size distribution
-    for (auto &bucket : m_sizeDistribution) {
-        bucket.count = 0;
-        bucket.percentage = 0.0;
-    }
+    m_generation++;
+
+    m_sizeHistogram.clear();
+    m_interArrival.clear();
+    m_protocolSizes.clear();
+    m_protocolInterArrival.clear();
+    m_cardinality.clear();
+    m_protocolCardinality.clear();
+
+    m_captureBaseline = AnomalyDetector::Baseline();
+    m_protocolBaselines.clear();
+    m_protocolIntervalPackets.clear();
+    m_activeEndpoints.clear();
+    m_pendingAlerts.clear();
+
+    // Releasing the caches empties the tables
+    m_addressIds.clear();
+    m_protocolIds.clear();
+    m_tcpProtocolId = m_protocolIds.intern(QStringLiteral("TCP")).id;
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const Snapshot>(std::make_shared<Snapshot>()));
 }
 
 void StatisticsEngine::reset() {
     clear();
 }
 
-void StatisticsEngine::updateProtocolStats(const std::shared_ptr<PacketModel> &packet) {
-    QString proto = packet->protocol;
-    
-    if (!m_protocolStats.contains(proto)) {
-        ProtocolStats stats;
-        stats.protocol = proto;
-        stats.firstSeen = packet->timestamp;
+void StatisticsEngine::updateProtocolStats(const std::shared_ptr<PacketModel> &packet,
+                                           quint32 protocolId, qint64 timeUs) {
+    ProtocolStats &stats = protocolEntry(m_protocolStats, protocolId);
+    if (stats.packetCount == 0) {
+        stats.protocol = packet->protocol;
         stats.minPacketSize = packet->length;
-        m_protocolStats.insert(proto, stats);
+    }
+    if (stats.firstSeenUs == InvalidTimestamp) {
+        stats.firstSeenUs = timeUs;
     }
 
-    ProtocolStats &stats = m_protocolStats[proto];
     stats.packetCount++;
     stats.byteCount += packet->length;
-    stats.lastSeen = packet->timestamp;
+    stats.lastSeenUs = timeUs;
 
     if (packet->length < stats.minPacketSize) {
         stats.minPacketSize = packet->length;
@@ -139,116 +1297,348 @@ void StatisticsEngine::updateProtocolStats(const std::shared_ptr<PacketModel> &p
     if (packet->length > stats.maxPacketSize) {
         stats.maxPacketSize = packet->length;
     }
+}
 
-    stats.avgPacketSize = static_cast<double>(stats.byteCount) / stats.packetCount;
+void StatisticsEngine::finalizeProtocolStats(ProtocolStats &stats) const {
+    // Derived fields are only computed when read; the hot path keeps raw counters
+    stats.avgPacketSize = (stats.packetCount > 0) ?
+        static_cast<double>(stats.byteCount) / stats.packetCount : 0.0;
+    stats.percentage = (m_captureStats.totalPackets > 0) ?
+        (static_cast<double>(stats.packetCount) / m_captureStats.totalPackets) * 100.0 : 0.0;
+    stats.bytesPercentage = (m_captureStats.totalBytes > 0) ?
+        (static_cast<double>(stats.byteCount) / m_captureStats.totalBytes) * 100.0 : 0.0;
+}
 
-    recalculateProtocolPercentages();
-    emit protocolStatsUpdated();
+const QList<ProtocolStats> &StatisticsEngine::protocolSnapshot() const {
+    if (m_protocolSnapshotGeneration != m_generation) {
+        m_protocolSnapshot.clear();
+        for (const ProtocolStats &stats : m_protocolStats) {
+            if (stats.packetCount == 0) continue;
+            m_protocolSnapshot.append(stats);
+            finalizeProtocolStats(m_protocolSnapshot.last());
+        }
+        m_protocolSnapshotGeneration = m_generation;
+    }
+    return m_protocolSnapshot;
 }
 
-void StatisticsEngine::recalculateProtocolPercentages() {
-    for (auto &stats : m_protocolStats) {
-        stats.percentage = (m_captureStats.totalPackets > 0) ?
-            (static_cast<double>(stats.packetCount) / m_captureStats.totalPackets) * 100.0 : 0.0;
-        stats.bytesPercentage = (m_captureStats.totalBytes > 0) ?
-            (static_cast<double>(stats.byteCount) / m_captureStats.totalBytes) * 100.0 : 0.0;
+const QList<PacketSizeBucket> &StatisticsEngine::sizeDistributionSnapshot() const {
+    if (m_sizeSnapshotGeneration != m_generation) {
+        m_sizeSnapshot = sizeBuckets(m_sizeHistogram, m_sizeBucketBoundaries);
+        m_sizeSnapshotGeneration = m_generation;
     }
+    return m_sizeSnapshot;
 }
 
-void StatisticsEngine::updateEndpointStats(const std::shared_ptr<PacketModel> &packet) {
+void StatisticsEngine::updateEndpointStats(const std::shared_ptr<PacketModel> &packet,
+                                           quint32 protocolId, const Symbol &src,
+                                           const Symbol &dst, qint64 timeUs) {
     // Update source endpoint
-    if (!packet->srcIP.isEmpty()) {
-        if (!m_endpointStats.contains(packet->srcIP)) {
-            EndpointStats stats;
-            stats.address = packet->srcIP;
-            stats.firstSeen = packet->timestamp;
-            m_endpointStats.insert(packet->srcIP, stats);
+    if (src.id != SymbolTable::EmptyId) {
+        EndpointRecord &record = m_endpointStats[src.id];
+        EndpointStats &srcStats = record.stats;
+        if (srcStats.firstSeenUs == InvalidTimestamp) {
+            srcStats.firstSeenUs = timeUs;
         }
-
-        EndpointStats &srcStats = m_endpointStats[packet->srcIP];
         srcStats.packetsSent++;
         srcStats.bytesSent += packet->length;
         srcStats.totalPackets++;
         srcStats.totalBytes += packet->length;
-        srcStats.protocols.insert(packet->protocol);
         srcStats.portsSrc.insert(packet->srcPort);
-        srcStats.lastSeen = packet->timestamp;
+        srcStats.lastSeenUs = timeUs;
+        record.protocolIds.insert(protocolId);
+        if (dst.id != SymbolTable::EmptyId) record.peers.addKey(dst.key);
+        if (packet->dstPort > 0) record.portsContacted.addKey(packet->dstPort);
+        m_endpointRank.increment(src.id);
+        m_endpointByteRank.add(src.id, packet->length);
     }
 
     // Update destination endpoint
-    if (!packet->dstIP.isEmpty()) {
-        if (!m_endpointStats.contains(packet->dstIP)) {
-            EndpointStats stats;
-            stats.address = packet->dstIP;
-            stats.firstSeen = packet->timestamp;
-            m_endpointStats.insert(packet->dstIP, stats);
+    if (dst.id != SymbolTable::EmptyId) {
+        EndpointRecord &record = m_endpointStats[dst.id];
+        EndpointStats &dstStats = record.stats;
+        if (dstStats.firstSeenUs == InvalidTimestamp) {
+            dstStats.firstSeenUs = timeUs;
         }
-
-        EndpointStats &dstStats = m_endpointStats[packet->dstIP];
         dstStats.packetsReceived++;
         dstStats.bytesReceived += packet->length;
         dstStats.totalPackets++;
         dstStats.totalBytes += packet->length;
-        dstStats.protocols.insert(packet->protocol);
         dstStats.portsDst.insert(packet->dstPort);
-        dstStats.lastSeen = packet->timestamp;
+        dstStats.lastSeenUs = timeUs;
+        record.protocolIds.insert(protocolId);
+        if (src.id != SymbolTable::EmptyId) record.peers.addKey(src.key);
+        m_endpointRank.increment(dst.id);
+        m_endpointByteRank.add(dst.id, packet->length);
     }
 
     // Enforce endpoint limit
     if (m_endpointStats.size() > m_maxEndpoints) {
         enforceEndpointLimit();
     }
-
-    emit endpointStatsUpdated();
 }
 
 void StatisticsEngine::enforceEndpointLimit() {
-    // Remove endpoints with lowest packet count
-    while (m_endpointStats.size() > m_maxEndpoints) {
-        QString minAddress;
-        quint64 minPackets = UINT64_MAX;
+    // Remove endpoints with lowest packet count; the rank keeps them at its low end
+    while (m_endpointStats.size() > m_maxEndpoints && !m_endpointRank.isEmpty()) {
+        const quint32 minAddress = m_endpointRank.minKey();
+        m_endpointRank.remove(minAddress);
+        m_endpointByteRank.remove(minAddress);
+        auto it = m_endpointStats.find(minAddress);
+        if (it == m_endpointStats.end()) continue;
 
-        for (auto it = m_endpointStats.constBegin(); it != m_endpointStats.constEnd(); ++it) {
-            if (it.value().totalPackets < minPackets) {
-                minPackets = it.value().totalPackets;
-                minAddress = it.key();
+        // The ID may be reused once released, so it must not stay listed as
+        // active; the last entry takes its place to keep this O(1)
+        const int activeIndex = it->activeIndex;
+        if (activeIndex >= 0) {
+            const quint32 last = m_activeEndpoints.last();
+            m_activeEndpoints[activeIndex] = last;
+            m_activeEndpoints.removeLast();
+            auto moved = m_endpointStats.find(last);
+            if (last != minAddress && moved != m_endpointStats.end()) {
+                moved->activeIndex = activeIndex;
             }
         }
+        m_endpointStats.erase(it);
+        m_addressIds.forget(m_addressNames.name(minAddress));
+    }
+}
+
+StatisticsEngine::EndpointRecord::EndpointRecord()
+    : peers(EndpointCardinalityPrecision)
+    , portsContacted(EndpointCardinalityPrecision)
+    , portsAtIntervalStart(0)
+    , intervalPackets(0)
+    , intervalSyns(0)
+    , intervalSynAcks(0)
+    , activeIndex(-1)
+{
+}
+
+void StatisticsEngine::EndpointRecord::merge(const EndpointRecord &other) {
+    mergeEndpointStats(stats, other.stats);
+    protocolIds.unite(other.protocolIds);
+    peers.merge(other.peers);
+    portsContacted.merge(other.portsContacted);
+}
+
+EndpointStats StatisticsEngine::endpointOutput(const QString &address,
+                                               const EndpointRecord &record) const {
+    EndpointStats stats = record.stats;
+    stats.address = address;
+    stats.distinctPeers = record.peers.estimate();
+    stats.distinctPortsContacted = record.portsContacted.estimate();
+    for (quint32 protocolId : record.protocolIds) {
+        stats.protocols.insert(m_protocolNames.name(protocolId));
+    }
+    return stats;
+}
+
+StatisticsEngine::CardinalitySketches::CardinalitySketches(int precision)
+    : sources(precision)
+    , destinations(precision)
+    , sourcePorts(precision)
+    , destinationPorts(precision)
+    , flows(precision)
+{
+}
+
+void StatisticsEngine::CardinalitySketches::add(const PacketModel &packet, const Symbol &protocol,
+                                                const Symbol &src, const Symbol &dst) {
+    if (src.id != SymbolTable::EmptyId) sources.addKey(src.key);
+    if (dst.id != SymbolTable::EmptyId) destinations.addKey(dst.key);
+    if (packet.srcPort > 0) sourcePorts.addKey(packet.srcPort);
+    if (packet.dstPort > 0) destinationPorts.addKey(packet.dstPort);
+
+    // Both directions of a flow hash alike
+    const quint64 from = HyperLogLog::hash(src.key ^ packet.srcPort);
+    const quint64 to = HyperLogLog::hash(dst.key ^ packet.dstPort);
+    const quint64 low = qMin(from, to) ^ protocol.key;
+    flows.add(HyperLogLog::hash(HyperLogLog::hash(low) ^ qMax(from, to)));
+}
+
+void StatisticsEngine::CardinalitySketches::merge(const CardinalitySketches &other) {
+    sources.merge(other.sources);
+    destinations.merge(other.destinations);
+    sourcePorts.merge(other.sourcePorts);
+    destinationPorts.merge(other.destinationPorts);
+    flows.merge(other.flows);
+}
+
+void StatisticsEngine::CardinalitySketches::clear() {
+    sources.clear();
+    destinations.clear();
+    sourcePorts.clear();
+    destinationPorts.clear();
+    flows.clear();
+}
+
+CardinalityEstimate StatisticsEngine::CardinalitySketches::estimate() const {
+    CardinalityEstimate estimate;
+    estimate.sources = sources.estimate();
+    estimate.destinations = destinations.estimate();
+    estimate.sourcePorts = sourcePorts.estimate();
+    estimate.destinationPorts = destinationPorts.estimate();
+    estimate.flows = flows.estimate();
+    estimate.relativeError = flows.relativeError();
+    return estimate;
+}
+
+void StatisticsEngine::updateCardinality(const std::shared_ptr<PacketModel> &packet,
+                                         const Symbol &protocol, const Symbol &src,
+                                         const Symbol &dst) {
+    m_cardinality.add(*packet, protocol, src, dst);
+    protocolSlot(m_protocolCardinality, protocol.id,
+                 CardinalitySketches(ProtocolCardinalityPrecision))
+        .add(*packet, protocol, src, dst);
+}
+
+void StatisticsEngine::updateDetectionCounters(const std::shared_ptr<PacketModel> &packet,
+                                               quint32 protocolId, quint32 srcId, quint32 dstId) {
+    protocolSlot(m_protocolIntervalPackets, protocolId, quint64(0))++;
+
+    // Half-open handshakes are counted against the endpoint being connected to
+    bool syn = false;
+    bool synAck = false;
+    if (protocolId == m_tcpProtocolId) {
+        const TcpHeader tcp = TcpHeader::fromPacket(*packet);
+        syn = tcp.has(TcpHeader::Syn) && !tcp.has(TcpHeader::Ack);
+        synAck = tcp.has(TcpHeader::Syn) && tcp.has(TcpHeader::Ack);
+    }
+
+    // The endpoint limit may already have evicted either record
+    auto src = m_endpointStats.find(srcId);
+    if (srcId != SymbolTable::EmptyId && src != m_endpointStats.end()) {
+        if (src->activeIndex < 0) {
+            src->activeIndex = m_activeEndpoints.size();
+            m_activeEndpoints.append(srcId);
+        }
+        src->intervalPackets++;
+        if (synAck) src->intervalSynAcks++;
+    }
+    auto dst = m_endpointStats.find(dstId);
+    if (dstId != SymbolTable::EmptyId && dstId != srcId && dst != m_endpointStats.end()) {
+        if (dst->activeIndex < 0) {
+            dst->activeIndex = m_activeEndpoints.size();
+            m_activeEndpoints.append(dstId);
+        }
+        dst->intervalPackets++;
+        if (syn) dst->intervalSyns++;
+    }
+}
+
+void StatisticsEngine::detectAnomalies(qint64 intervalStartMs, quint64 intervalPackets,
+                                       qint64 idleIntervals) {
+    AnomalyAlert alert;
+    if (m_detector.observe(m_captureBaseline, intervalPackets,
+                           m_detector.settings().minimumPackets, &alert)) {
+        raiseAlert(alert, AnomalyAlert::Capture, QString(), intervalStartMs);
+    }
+    m_detector.observeIdle(m_captureBaseline, idleIntervals);
+
+    // A protocol silent in the interval scores a zero, and every protocol
+    // scores a zero for each empty interval after it, so baselines decay
+    // across idle gaps instead of holding their busy-time mean
+    m_protocolBaselines.resize(m_protocolIntervalPackets.size());
+    for (int id = 0; id < m_protocolIntervalPackets.size(); ++id) {
+        if (m_detector.observe(m_protocolBaselines[id], m_protocolIntervalPackets.at(id),
+                               m_detector.settings().minimumPackets, &alert)) {
+            raiseAlert(alert, AnomalyAlert::Protocol,
+                       m_protocolNames.name(static_cast<quint32>(id)), intervalStartMs);
+        }
+        m_detector.observeIdle(m_protocolBaselines[id], idleIntervals);
+        m_protocolIntervalPackets[id] = 0;
+    }
+
+    // Endpoint baselines only advance in intervals the endpoint was active in,
+    // which keeps the cost proportional to the active set
+    for (quint32 addressId : m_activeEndpoints) {
+        auto it = m_endpointStats.find(addressId);
+        if (it == m_endpointStats.end()) continue;
+        EndpointRecord &record = *it;
+
+        const QString address = m_addressNames.name(addressId);
+        if (m_detector.observe(record.packetBaseline, record.intervalPackets,
+                               m_detector.settings().minimumPackets, &alert)) {
+            raiseAlert(alert, AnomalyAlert::Endpoint, address, intervalStartMs);
+        }
 
-        if (!minAddress.isEmpty()) {
-            m_endpointStats.remove(minAddress);
+        const quint64 ports = record.portsContacted.estimate();
+        const quint64 newPorts = ports > record.portsAtIntervalStart ?
+            ports - record.portsAtIntervalStart : 0;
+        if (m_detector.observeScan(record.scanBaseline, newPorts, &alert)) {
+            raiseAlert(alert, AnomalyAlert::Endpoint, address, intervalStartMs);
+        }
+        if (m_detector.observeHandshakes(record.intervalSyns, record.intervalSynAcks, &alert)) {
+            raiseAlert(alert, AnomalyAlert::Endpoint, address, intervalStartMs);
         }
+
+        record.portsAtIntervalStart = ports;
+        record.intervalPackets = 0;
+        record.intervalSyns = 0;
+        record.intervalSynAcks = 0;
+        record.activeIndex = -1;
     }
+    m_activeEndpoints.clear();
 }
 
-void StatisticsEngine::updateTimeSeries(const std::shared_ptr<PacketModel> &packet) {
-    qint64 msSinceIntervalStart = m_currentIntervalStart.msecsTo(packet->timestamp);
+void StatisticsEngine::raiseAlert(AnomalyAlert alert, AnomalyAlert::Scope scope,
+                                  const QString &subject, qint64 intervalStartMs) {
+    alert.scope = scope;
+    alert.subject = subject;
+    alert.intervalStartUs = intervalStartMs * 1000;
+    if (m_pendingAlerts.size() >= MaxPendingAlerts) {
+        m_pendingAlerts.removeFirst();
+    }
+    m_pendingAlerts.append(alert);
+}
 
-    if (msSinceIntervalStart >= m_timeSeriesInterval) {
-        // Finalize current interval
-        PacketRatePoint point;
-        point.timestamp = m_currentIntervalStart;
-        point.packetCount = m_currentIntervalPackets;
-        point.byteCount = m_currentIntervalBytes;
+void StatisticsEngine::emitAlerts(const QList<AnomalyAlert> &alerts) {
+    for (const AnomalyAlert &alert : alerts) {
+        emit anomalyDetected(alert);
+    }
+}
 
-        double intervalSeconds = m_timeSeriesInterval / 1000.0;
-        point.packetsPerSecond = m_currentIntervalPackets / intervalSeconds;
-        point.bitsPerSecond = (m_currentIntervalBytes * 8.0) / intervalSeconds;
+bool StatisticsEngine::updateTimeSeries(const std::shared_ptr<PacketModel> &packet,
+                                        quint32 protocolId, qint64 timeUs) {
+    const qint64 ms = timestampMs(timeUs);
+    m_rateSeries.add(ms, 1, packet->length);
+    protocolRates(m_protocolRates, protocolId).add(ms, 1, packet->length);
 
-        m_timeSeriesData.append(point);
+    // The current interval only drives the rate signal and peak tracking
+    const qint64 start = intervalStart(ms, m_timeSeriesInterval);
+    bool intervalClosed = false;
+    if (m_currentIntervalStartMs < 0) {
+        m_currentIntervalStartMs = start;
+    } else if (start < m_currentIntervalStartMs) {
+        return false;                             // Late packet; its interval is already closed
+    } else if (start > m_currentIntervalStartMs) {
+        // Finalize current interval
+        RateSeries::Sample sample;
+        sample.startMs = m_currentIntervalStartMs;
+        sample.packets = m_currentIntervalPackets;
+        sample.bytes = m_currentIntervalBytes;
+        m_lastRate = ratePoint(sample, m_timeSeriesInterval);
 
         // Update peak rates
-        if (point.packetsPerSecond > m_peakPacketsPerSecond) {
-            m_peakPacketsPerSecond = point.packetsPerSecond;
+        if (m_lastRate.packetsPerSecond > m_peakPacketsPerSecond) {
+            m_peakPacketsPerSecond = m_lastRate.packetsPerSecond;
+        }
+        if (m_lastRate.bitsPerSecond > m_peakBitsPerSecond) {
+            m_peakBitsPerSecond = m_lastRate.bitsPerSecond;
         }
-        if (point.bitsPerSecond > m_peakBitsPerSecond) {
-            m_peakBitsPerSecond = point.bitsPerSecond;
+
+        // After an idle gap the latest completed interval is an empty one
+        if (start - m_currentIntervalStartMs > m_timeSeriesInterval) {
+            RateSeries::Sample idle;
+            idle.startMs = start - m_timeSeriesInterval;
+            m_lastRate = ratePoint(idle, m_timeSeriesInterval);
         }
 
-        emit rateUpdated(point.packetsPerSecond, point.bitsPerSecond);
+        intervalClosed = true;
 
         // Start new interval
-        m_currentIntervalStart = m_currentIntervalStart.addMSecs(m_timeSeriesInterval);
+        m_currentIntervalStartMs = start;
         m_currentIntervalPackets = 0;
         m_currentIntervalBytes = 0;
     }
@@ -256,36 +1646,32 @@ void StatisticsEngine::updateTimeSeries(const std::shared_ptr<PacketModel> &pack
     // Add to current interval
     m_currentIntervalPackets++;
     m_currentIntervalBytes += packet->length;
+    return intervalClosed;
 }
 
-void StatisticsEngine::updateSizeDistribution(const std::shared_ptr<PacketModel> &packet) {
-    int bucketIdx = getSizeBucketIndex(packet->length);
-    if (bucketIdx >= 0 && bucketIdx < m_sizeDistribution.size()) {
-        m_sizeDistribution[bucketIdx].count++;
+void StatisticsEngine::updateDistributions(const std::shared_ptr<PacketModel> &packet,
+                                           quint32 protocolId, qint64 timeUs, qint64 previousUs,
+                                           qint64 protocolPreviousUs) {
+    m_sizeHistogram.record(packet->length);
+    protocolHistogram(m_protocolSizes, protocolId, SizePrecision).record(packet->length);
 
-        // Recalculate percentages
-        for (auto &bucket : m_sizeDistribution) {
-            bucket.percentage = (m_captureStats.totalPackets > 0) ?
-                (static_cast<double>(bucket.count) / m_captureStats.totalPackets) * 100.0 : 0.0;
-        }
+    const qint64 gapUs = interArrivalUs(previousUs, timeUs);
+    if (gapUs >= 0) {
+        m_interArrival.record(static_cast<quint64>(gapUs));
     }
-}
-
-int StatisticsEngine::getSizeBucketIndex(quint64 size) const {
-    for (int i = 0; i < m_sizeDistribution.size(); ++i) {
-        if (size >= m_sizeDistribution[i].minSize && size < m_sizeDistribution[i].maxSize) {
-            return i;
-        }
+    const qint64 protocolGapUs = interArrivalUs(protocolPreviousUs, timeUs);
+    if (protocolGapUs >= 0) {
+        protocolHistogram(m_protocolInterArrival, protocolId, InterArrivalPrecision)
+            .record(static_cast<quint64>(protocolGapUs));
     }
-    return -1;
 }
 
 void StatisticsEngine::updatePortStats(const std::shared_ptr<PacketModel> &packet) {
     if (packet->srcPort > 0) {
-        m_srcPortStats[packet->srcPort]++;
+        m_srcPortStats.increment(packet->srcPort);
     }
     if (packet->dstPort > 0) {
-        m_dstPortStats[packet->dstPort]++;
+        m_dstPortStats.increment(packet->dstPort);
     }
 }
 
@@ -301,6 +1687,10 @@ void StatisticsEngine::trackError(const std::shared_ptr<PacketModel> &packet) {
 }
 
 CaptureStatistics StatisticsEngine::getCaptureStatistics() const {
+    if (m_perThreadAccumulation) {
+        return std::atomic_load(&m_snapshot)->capture;
+    }
+
     QMutexLocker locker(&m_mutex);
     CaptureStatistics stats = m_captureStats;
     stats.peakPacketsPerSecond = m_peakPacketsPerSecond;
@@ -309,74 +1699,252 @@ CaptureStatistics StatisticsEngine::getCaptureStatistics() const {
 }
 
 QList<ProtocolStats> StatisticsEngine::getProtocolStatistics() const {
+    if (m_perThreadAccumulation) {
+        return std::atomic_load(&m_snapshot)->protocols;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return protocolSnapshot();
+}
+
+ProtocolStats StatisticsEngine::getProtocolStats(const QString &protocol) const {
+    quint32 protocolId = 0;
+    if (!m_protocolNames.lookup(protocol, &protocolId)) return ProtocolStats();
+
     QMutexLocker locker(&m_mutex);
-    return m_protocolStats.values();
+    ProtocolStats stats = m_protocolStats.value(static_cast<int>(protocolId));
+    finalizeProtocolStats(stats);
+    return stats;
 }
 
 QList<EndpointStats> StatisticsEngine::getEndpointStatistics() const {
     QMutexLocker locker(&m_mutex);
-    return m_endpointStats.values();
+
+    QList<EndpointStats> result;
+    result.reserve(m_endpointStats.size());
+    for (auto it = m_endpointStats.constBegin(); it != m_endpointStats.constEnd(); ++it) {
+        result.append(endpointOutput(m_addressNames.name(it.key()), it.value()));
+    }
+    return result;
+}
+
+void StatisticsEngine::visitEndpointStatistics(
+    const std::function<bool(const EndpointStats &)> &visitor) const {
+    QMutexLocker locker(&m_mutex);
+    for (auto it = m_endpointStats.constBegin(); it != m_endpointStats.constEnd(); ++it) {
+        if (!visitor(endpointOutput(m_addressNames.name(it.key()), it.value()))) return;
+    }
+}
+
+EndpointStats StatisticsEngine::getEndpointStats(const QString &address) const {
+    // Resolved under the lock: an evicted address's ID may be reused
+    QMutexLocker locker(&m_mutex);
+    quint32 addressId = 0;
+    if (!m_addressNames.lookup(address, &addressId)) return EndpointStats();
+
+    auto it = m_endpointStats.constFind(addressId);
+    return it != m_endpointStats.constEnd() ? endpointOutput(address, it.value()) : EndpointStats();
+}
+
+QList<EndpointStats> StatisticsEngine::getTopEndpointsByPackets(int count) const {
+    QMutexLocker locker(&m_mutex);
+
+    QList<EndpointStats> result;
+    for (const auto &entry : m_endpointRank.top(count)) {
+        result.append(endpointOutput(m_addressNames.name(entry.first),
+                                     m_endpointStats.value(entry.first)));
+    }
+    return result;
+}
+
+QList<EndpointStats> StatisticsEngine::getTopEndpointsByBytes(int count) const {
+    QMutexLocker locker(&m_mutex);
+
+    // Ranked by the Space-Saving estimate; the returned stats are exact
+    QList<EndpointStats> result;
+    for (const auto &entry : m_endpointByteRank.top(count)) {
+        auto it = m_endpointStats.constFind(entry.first);
+        if (it != m_endpointStats.constEnd()) {
+            result.append(endpointOutput(m_addressNames.name(entry.first), it.value()));
+        }
+    }
+    return result;
 }
 
 QList<PacketRatePoint> StatisticsEngine::getPacketRateTimeSeries(int intervalMs) const {
+    if (m_perThreadAccumulation) {
+        const std::shared_ptr<const Snapshot> snapshot = std::atomic_load(&m_snapshot);
+        return ratePoints(snapshot->rates, snapshot->capture, intervalMs);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return ratePoints(m_rateSeries, m_captureStats, intervalMs);
+}
+
+QList<PacketRatePoint> StatisticsEngine::getPacketRateForProtocol(const QString &protocol,
+                                                                  int intervalMs) const {
+    quint32 protocolId = 0;
+    if (!m_protocolNames.lookup(protocol, &protocolId)) return QList<PacketRatePoint>();
+
+    // Sampled over the whole capture so the points line up with the overall series
     QMutexLocker locker(&m_mutex);
-    Q_UNUSED(intervalMs); // TODO: Support resampling
-    return m_timeSeriesData;
+    if (protocolId >= static_cast<quint32>(m_protocolRates.size())) return QList<PacketRatePoint>();
+    return ratePoints(m_protocolRates.at(static_cast<int>(protocolId)), m_captureStats, intervalMs);
 }
 
 QList<PacketSizeBucket> StatisticsEngine::getPacketSizeDistribution() const {
+    if (m_perThreadAccumulation) {
+        return std::atomic_load(&m_snapshot)->sizeDistribution;
+    }
+
     QMutexLocker locker(&m_mutex);
-    return m_sizeDistribution;
+    return sizeDistributionSnapshot();
 }
 
-QHash<quint16, quint64> StatisticsEngine::getTopSourcePorts(int count) const {
+QList<PacketSizeBucket> StatisticsEngine::getPacketSizeDistributionForProtocol(
+    const QString &protocol) const {
+    quint32 protocolId = 0;
+    if (!m_protocolNames.lookup(protocol, &protocolId)) return QList<PacketSizeBucket>();
+
     QMutexLocker locker(&m_mutex);
-    
-    QList<QPair<quint16, quint64>> sorted;
-    for (auto it = m_srcPortStats.constBegin(); it != m_srcPortStats.constEnd(); ++it) {
-        sorted.append(qMakePair(it.key(), it.value()));
+    if (protocolId >= static_cast<quint32>(m_protocolSizes.size())) return QList<PacketSizeBucket>();
+    return sizeBuckets(m_protocolSizes.at(static_cast<int>(protocolId)), m_sizeBucketBoundaries);
+}
+
+PercentileSummary StatisticsEngine::getPacketSizePercentiles() const {
+    if (m_perThreadAccumulation) {
+        return percentileSummary(std::atomic_load(&m_snapshot)->sizes);
     }
-    
-    std::sort(sorted.begin(), sorted.end(),
-              [](const QPair<quint16, quint64> &a, const QPair<quint16, quint64> &b) {
-                  return a.second > b.second;
-              });
+
+    QMutexLocker locker(&m_mutex);
+    return percentileSummary(m_sizeHistogram);
+}
+
+PercentileSummary StatisticsEngine::getPacketSizePercentilesForProtocol(const QString &protocol) const {
+    quint32 protocolId = 0;
+    if (!m_protocolNames.lookup(protocol, &protocolId)) return PercentileSummary();
+
+    QMutexLocker locker(&m_mutex);
+    if (protocolId >= static_cast<quint32>(m_protocolSizes.size())) return PercentileSummary();
+    return percentileSummary(m_protocolSizes.at(static_cast<int>(protocolId)));
+}
+
+PercentileSummary StatisticsEngine::getInterArrivalPercentiles() const {
+    if (m_perThreadAccumulation) {
+        return percentileSummary(std::atomic_load(&m_snapshot)->interArrival);
+    }
+
+    QMutexLocker locker(&m_mutex);
+    return percentileSummary(m_interArrival);
+}
+
+PercentileSummary StatisticsEngine::getInterArrivalPercentilesForProtocol(const QString &protocol) const {
+    quint32 protocolId = 0;
+    if (!m_protocolNames.lookup(protocol, &protocolId)) return PercentileSummary();
+
+    QMutexLocker locker(&m_mutex);
+    if (protocolId >= static_cast<quint32>(m_protocolInterArrival.size())) return PercentileSummary();
+    return percentileSummary(m_protocolInterArrival.at(static_cast<int>(protocolId)));
+}
+
+CardinalityEstimates StatisticsEngine::getCardinalityEstimates() const {
+    CardinalitySketches overall;
+    QVector<CardinalitySketches> protocols;
+    {
+        QMutexLocker locker(&m_mutex);
+        overall = m_cardinality;
+        protocols = m_protocolCardinality;
+    }
+
+    // Estimated outside the lock from implicitly shared copies
+    return cardinalityEstimates(overall, protocols);
+}
+
+CardinalityEstimates StatisticsEngine::cardinalityEstimates(
+    const CardinalitySketches &overall, const QVector<CardinalitySketches> &protocols) const {
+    CardinalityEstimates estimates;
+    estimates.overall = overall.estimate();
+    for (int id = 0; id < protocols.size(); ++id) {
+        if (protocols.at(id).isEmpty()) continue;
+        estimates.byProtocol.insert(m_protocolNames.name(static_cast<quint32>(id)),
+                                    protocols.at(id).estimate());
+    }
+    return estimates;
+}
+
+QHash<quint16, quint64> StatisticsEngine::getTopSourcePorts(int count) const {
+    QMutexLocker locker(&m_mutex);
 
     QHash<quint16, quint64> result;
-    for (int i = 0; i < qMin(count, sorted.size()); ++i) {
-        result.insert(sorted[i].first, sorted[i].second);
+    for (const auto &entry : m_srcPortStats.top(count)) {
+        result.insert(entry.first, entry.second);
     }
     return result;
 }
 
 QHash<quint16, quint64> StatisticsEngine::getTopDestinationPorts(int count) const {
     QMutexLocker locker(&m_mutex);
-    
-    QList<QPair<quint16, quint64>> sorted;
-    for (auto it = m_dstPortStats.constBegin(); it != m_dstPortStats.constEnd(); ++it) {
-        sorted.append(qMakePair(it.key(), it.value()));
-    }
-    
-    std::sort(sorted.begin(), sorted.end(),
-              [](const QPair<quint16, quint64> &a, const QPair<quint16, quint64> &b) {
-                  return a.second > b.second;
-              });
 
     QHash<quint16, quint64> result;
-    for (int i = 0; i < qMin(count, sorted.size()); ++i) {
-        result.insert(sorted[i].first, sorted[i].second);
+    for (const auto &entry : m_dstPortStats.top(count)) {
+        result.insert(entry.first, entry.second);
     }
     return result;
 }
 
+QHash<quint16, quint64> StatisticsEngine::getPortUsage() const {
+    QMutexLocker locker(&m_mutex);
+
+    QHash<quint16, quint64> usage;
+    m_srcPortStats.forEachNonZero([&usage](quint16 port, quint64 count) {
+        usage[port] += count;
+    });
+    m_dstPortStats.forEachNonZero([&usage](quint16 port, quint64 count) {
+        usage[port] += count;
+    });
+    return usage;
+}
+
 void StatisticsEngine::setTimeSeriesInterval(int intervalMs) {
-    m_timeSeriesInterval = intervalMs;
+    m_timeSeriesInterval = qMax(1, intervalMs);
+}
+
+void StatisticsEngine::setPacketSizeBuckets(const QList<quint64> &boundaries) {
+    QList<quint64> sorted = boundaries;
+    std::sort(sorted.begin(), sorted.end());
+    sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+    if (sorted.isEmpty() || sorted.first() != 0) {
+        sorted.prepend(0);
+    }
+    if (sorted.last() != UINT64_MAX) {
+        sorted.append(UINT64_MAX);
+    }
+
+    // Buckets are a view over the histogram; the next read re-buckets
+    QMutexLocker locker(&m_mutex);
+    m_sizeBucketBoundaries = sorted;
+    m_generation++;
+    if (m_perThreadAccumulation) {
+        publishSnapshot();
+    }
 }
 
 void StatisticsEngine::setMaxEndpoints(int max) {
     m_maxEndpoints = max;
 }
 
+void StatisticsEngine::setNotificationInterval(int intervalMs) {
+    m_notifyIntervalMs = qMax(0, intervalMs);
+    if (m_notifyIntervalMs > 0) {
+        m_notifyTimer->start(m_notifyIntervalMs);
+    } else if (m_perThreadAccumulation) {
+        m_notifyTimer->start(DefaultMergeIntervalMs);
+    } else {
+        m_notifyTimer->stop();
+        publishPendingUpdates();
+    }
+}
+
 QString StatisticsEngine::getStatisticsSummary() const {
     QMutexLocker locker(&m_mutex);
     
@@ -392,3 +1960,353 @@ QString StatisticsEngine::getStatisticsSummary() const {
     
     return summary;
 }
+
+StatisticsEngine::ExportSnapshot StatisticsEngine::exportSnapshot(bool withEndpoints) const {
+    // Packets still in per-thread accumulators are merged first, outside
+    // m_mutex; merging only moves counts the engine already holds
+    if (m_perThreadAccumulation) {
+        const_cast<StatisticsEngine *>(this)->flushAccumulators();
+    }
+
+    QMutexLocker locker(&m_mutex);
+
+    ExportSnapshot snapshot;
+    snapshot.capture = m_captureStats;
+    snapshot.capture.peakPacketsPerSecond = m_peakPacketsPerSecond;
+    snapshot.capture.peakBitsPerSecond = m_peakBitsPerSecond;
+    snapshot.protocols = protocolSnapshot();
+    if (withEndpoints) {
+        snapshot.endpoints = m_endpointStats;
+        snapshot.addresses.reserve(m_endpointStats.size());
+        for (auto it = m_endpointStats.constBegin(); it != m_endpointStats.constEnd(); ++it) {
+            snapshot.addresses.insert(it.key(), m_addressNames.name(it.key()));
+        }
+    } else {
+        for (const auto &entry : m_endpointByteRank.top(RollingExportTopEndpoints)) {
+            auto it = m_endpointStats.constFind(entry.first);
+            if (it != m_endpointStats.constEnd()) {
+                snapshot.topEndpoints.append(endpointOutput(m_addressNames.name(entry.first),
+                                                            it.value()));
+            }
+        }
+    }
+    snapshot.rates = m_rateSeries;
+    snapshot.intervalMs = m_timeSeriesInterval;
+    snapshot.lastRate = m_lastRate;
+    snapshot.sizeDistribution = sizeDistributionSnapshot();
+    snapshot.sizes = m_sizeHistogram;
+    snapshot.interArrival = m_interArrival;
+    snapshot.cardinality = m_cardinality;
+    snapshot.protocolCardinality = m_protocolCardinality;
+    snapshot.srcPorts = m_srcPortStats;
+    snapshot.dstPorts = m_dstPortStats;
+    snapshot.errors = m_totalErrors;
+    snapshot.errorTypes = m_errorTypes;
+    return snapshot;
+}
+
+bool StatisticsEngine::exportStatisticsToJson(const QString &filePath) const {
+    const ExportSnapshot snapshot = exportSnapshot(true);
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    file.write("{\"capture\":");
+    file.write(QJsonDocument(captureJson(snapshot.capture)).toJson(QJsonDocument::Compact));
+
+    JsonArrayWriter protocols(file, "protocols");
+    for (const ProtocolStats &stats : snapshot.protocols) {
+        protocols.append(protocolJson(stats));
+    }
+    protocols.finish();
+
+    JsonArrayWriter endpoints(file, "endpoints");
+    for (auto it = snapshot.endpoints.constBegin(); it != snapshot.endpoints.constEnd(); ++it) {
+        endpoints.append(endpointJson(endpointOutput(snapshot.addresses.value(it.key()), it.value())));
+    }
+    endpoints.finish();
+
+    JsonArrayWriter rates(file, "timeSeries");
+    for (const PacketRatePoint &point :
+         ratePoints(snapshot.rates, snapshot.capture, snapshot.intervalMs)) {
+        rates.append(rateJson(point));
+    }
+    rates.finish();
+
+    JsonArrayWriter sizes(file, "packetSizes");
+    for (const PacketSizeBucket &bucket : snapshot.sizeDistribution) {
+        QJsonObject object;
+        object["minSize"] = jsonCount(bucket.minSize);
+        object["maxSize"] = jsonCount(bucket.maxSize);
+        object["count"] = jsonCount(bucket.count);
+        object["percentage"] = bucket.percentage;
+        sizes.append(object);
+    }
+    sizes.finish();
+
+    JsonArrayWriter ports(file, "ports");
+    for (int port = 0; port < PortCounters::PortCount; ++port) {
+        const quint64 source = snapshot.srcPorts.count(static_cast<quint16>(port));
+        const quint64 destination = snapshot.dstPorts.count(static_cast<quint16>(port));
+        if (source == 0 && destination == 0) continue;
+        QJsonObject object;
+        object["port"] = port;
+        object["sourcePackets"] = jsonCount(source);
+        object["destinationPackets"] = jsonCount(destination);
+        ports.append(object);
+    }
+    ports.finish();
+
+    QJsonObject errorTypes;
+    for (auto it = snapshot.errorTypes.constBegin(); it != snapshot.errorTypes.constEnd(); ++it) {
+        errorTypes[it.key()] = jsonCount(it.value());
+    }
+    QJsonObject errors;
+    errors["total"] = jsonCount(snapshot.errors);
+    errors["byType"] = errorTypes;
+
+    writeJsonMember(file, "packetSizePercentiles", percentileJson(percentileSummary(snapshot.sizes)));
+    writeJsonMember(file, "interArrivalPercentiles",
+                    percentileJson(percentileSummary(snapshot.interArrival)));
+    writeJsonMember(file, "cardinality", cardinalitiesJson(
+        cardinalityEstimates(snapshot.cardinality, snapshot.protocolCardinality)));
+    writeJsonMember(file, "errors", errors);
+    file.write("}\n");
+
+    return file.commit();
+}
+
+bool StatisticsEngine::exportStatisticsToCsv(const QString &filePath) const {
+    const ExportSnapshot snapshot = exportSnapshot(true);
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Text)) {
+        return false;
+    }
+
+    // One section per table, each with its own header row
+    QTextStream out(&file);
+    const CaptureStatistics &capture = snapshot.capture;
+    out << "# Capture\n"
+        << "totalPackets,totalBytes,droppedPackets,captureStartUs,captureEndUs,durationSeconds,"
+           "avgPacketsPerSecond,avgBitsPerSecond,peakPacketsPerSecond,peakBitsPerSecond,"
+           "avgPacketSize,minPacketSize,maxPacketSize\n"
+        << capture.totalPackets << ',' << capture.totalBytes << ',' << capture.droppedPackets << ','
+        << csvTime(capture.captureStartUs) << ',' << csvTime(capture.captureEndUs) << ','
+        << capture.captureDuration << ',' << capture.avgPacketsPerSecond << ','
+        << capture.avgBitsPerSecond << ',' << capture.peakPacketsPerSecond << ','
+        << capture.peakBitsPerSecond << ',' << capture.avgPacketSize << ','
+        << capture.minPacketSize << ',' << capture.maxPacketSize << '\n';
+
+    out << "\n# Protocols\n"
+        << "protocol,packets,bytes,percentage,bytesPercentage,avgPacketSize,minPacketSize,"
+           "maxPacketSize,firstSeenUs,lastSeenUs\n";
+    for (const ProtocolStats &stats : snapshot.protocols) {
+        out << csvField(stats.protocol) << ',' << stats.packetCount << ',' << stats.byteCount << ','
+            << stats.percentage << ',' << stats.bytesPercentage << ',' << stats.avgPacketSize << ','
+            << stats.minPacketSize << ',' << stats.maxPacketSize << ','
+            << csvTime(stats.firstSeenUs) << ',' << csvTime(stats.lastSeenUs) << '\n';
+    }
+
+    out << "\n# Endpoints\n"
+        << "address,packetsSent,packetsReceived,bytesSent,bytesReceived,distinctPeers,"
+           "distinctPortsContacted,protocols,firstSeenUs,lastSeenUs\n";
+    for (auto it = snapshot.endpoints.constBegin(); it != snapshot.endpoints.constEnd(); ++it) {
+        const EndpointStats stats = endpointOutput(snapshot.addresses.value(it.key()), it.value());
+        const QStringList protocols = sortedProtocols(stats);
+        out << csvField(stats.address) << ',' << stats.packetsSent << ','
+            << stats.packetsReceived << ',' << stats.bytesSent << ',' << stats.bytesReceived << ','
+            << stats.distinctPeers << ',' << stats.distinctPortsContacted << ','
+            << csvField(protocols.join(QLatin1Char(';'))) << ',' << csvTime(stats.firstSeenUs)
+            << ',' << csvTime(stats.lastSeenUs) << '\n';
+    }
+
+    out << "\n# Time series\n"
+        << "timestampUs,packets,bytes,packetsPerSecond,bitsPerSecond\n";
+    for (const PacketRatePoint &point :
+         ratePoints(snapshot.rates, snapshot.capture, snapshot.intervalMs)) {
+        out << csvTime(point.timestampUs) << ',' << point.packetCount << ',' << point.byteCount
+            << ',' << point.packetsPerSecond << ',' << point.bitsPerSecond << '\n';
+    }
+
+    out << "\n# Packet sizes\n"
+        << "minSize,maxSize,count,percentage\n";
+    for (const PacketSizeBucket &bucket : snapshot.sizeDistribution) {
+        out << bucket.minSize << ',' << bucket.maxSize << ',' << bucket.count << ','
+            << bucket.percentage << '\n';
+    }
+
+    out << "\n# Ports\n"
+        << "port,sourcePackets,destinationPackets\n";
+    for (int port = 0; port < PortCounters::PortCount; ++port) {
+        const quint64 source = snapshot.srcPorts.count(static_cast<quint16>(port));
+        const quint64 destination = snapshot.dstPorts.count(static_cast<quint16>(port));
+        if (source == 0 && destination == 0) continue;
+        out << port << ',' << source << ',' << destination << '\n';
+    }
+
+    out << "\n# Errors\n"
+        << "type,count\n";
+    for (auto it = snapshot.errorTypes.constBegin(); it != snapshot.errorTypes.constEnd(); ++it) {
+        out << csvField(it.key()) << ',' << it.value() << '\n';
+    }
+
+    out.flush();
+    return file.commit();
+}
+
+bool StatisticsEngine::exportStatisticsToBinary(const QString &filePath) const {
+    const ExportSnapshot snapshot = exportSnapshot(true);
+
+    QSaveFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly)) {
+        return false;
+    }
+
+    QDataStream out(&file);
+    out.setVersion(QDataStream::Qt_5_0);
+    out << BinaryExportMagic << BinaryExportVersion << static_cast<quint16>(5);
+
+    const CaptureStatistics &capture = snapshot.capture;
+    writeTableHeader(out, QStringLiteral("capture"), 1, 10);
+    writeColumn(out, QStringLiteral("totalPackets"), 1, [&](int) { return capture.totalPackets; });
+    writeColumn(out, QStringLiteral("totalBytes"), 1, [&](int) { return capture.totalBytes; });
+    writeColumn(out, QStringLiteral("droppedPackets"), 1, [&](int) { return capture.droppedPackets; });
+    writeColumn(out, QStringLiteral("captureStartUs"), 1, [&](int) { return capture.captureStartUs; });
+    writeColumn(out, QStringLiteral("captureEndUs"), 1, [&](int) { return capture.captureEndUs; });
+    writeColumn(out, QStringLiteral("durationSeconds"), 1, [&](int) { return capture.captureDuration; });
+    writeColumn(out, QStringLiteral("peakPacketsPerSecond"), 1,
+                [&](int) { return capture.peakPacketsPerSecond; });
+    writeColumn(out, QStringLiteral("peakBitsPerSecond"), 1,
+                [&](int) { return capture.peakBitsPerSecond; });
+    writeColumn(out, QStringLiteral("minPacketSize"), 1, [&](int) { return capture.minPacketSize; });
+    writeColumn(out, QStringLiteral("maxPacketSize"), 1, [&](int) { return capture.maxPacketSize; });
+
+    const QList<ProtocolStats> &protocols = snapshot.protocols;
+    const int protocolRows = protocols.size();
+    writeTableHeader(out, QStringLiteral("protocols"), protocolRows, 7);
+    writeColumn(out, QStringLiteral("protocol"), protocolRows,
+                [&](int row) { return protocols.at(row).protocol; });
+    writeColumn(out, QStringLiteral("packets"), protocolRows,
+                [&](int row) { return protocols.at(row).packetCount; });
+    writeColumn(out, QStringLiteral("bytes"), protocolRows,
+                [&](int row) { return protocols.at(row).byteCount; });
+    writeColumn(out, QStringLiteral("minPacketSize"), protocolRows,
+                [&](int row) { return protocols.at(row).minPacketSize; });
+    writeColumn(out, QStringLiteral("maxPacketSize"), protocolRows,
+                [&](int row) { return protocols.at(row).maxPacketSize; });
+    writeColumn(out, QStringLiteral("firstSeenUs"), protocolRows,
+                [&](int row) { return protocols.at(row).firstSeenUs; });
+    writeColumn(out, QStringLiteral("lastSeenUs"), protocolRows,
+                [&](int row) { return protocols.at(row).lastSeenUs; });
+
+    // Columns are written one after another, so the rows are fixed up front
+    QVector<quint32> addressIds;
+    QVector<const EndpointRecord *> records;
+    addressIds.reserve(snapshot.endpoints.size());
+    records.reserve(snapshot.endpoints.size());
+    for (auto it = snapshot.endpoints.constBegin(); it != snapshot.endpoints.constEnd(); ++it) {
+        addressIds.append(it.key());
+        records.append(&it.value());
+    }
+    const int endpointRows = records.size();
+    writeTableHeader(out, QStringLiteral("endpoints"), endpointRows, 9);
+    writeColumn(out, QStringLiteral("address"), endpointRows,
+                [&](int row) { return snapshot.addresses.value(addressIds.at(row)); });
+    writeColumn(out, QStringLiteral("packetsSent"), endpointRows,
+                [&](int row) { return records.at(row)->stats.packetsSent; });
+    writeColumn(out, QStringLiteral("packetsReceived"), endpointRows,
+                [&](int row) { return records.at(row)->stats.packetsReceived; });
+    writeColumn(out, QStringLiteral("bytesSent"), endpointRows,
+                [&](int row) { return records.at(row)->stats.bytesSent; });
+    writeColumn(out, QStringLiteral("bytesReceived"), endpointRows,
+                [&](int row) { return records.at(row)->stats.bytesReceived; });
+    writeColumn(out, QStringLiteral("distinctPeers"), endpointRows,
+                [&](int row) { return records.at(row)->peers.estimate(); });
+    writeColumn(out, QStringLiteral("distinctPortsContacted"), endpointRows,
+                [&](int row) { return records.at(row)->portsContacted.estimate(); });
+    writeColumn(out, QStringLiteral("firstSeenUs"), endpointRows,
+                [&](int row) { return records.at(row)->stats.firstSeenUs; });
+    writeColumn(out, QStringLiteral("lastSeenUs"), endpointRows,
+                [&](int row) { return records.at(row)->stats.lastSeenUs; });
+
+    const QList<PacketRatePoint> rates =
+        ratePoints(snapshot.rates, snapshot.capture, snapshot.intervalMs);
+    const int rateRows = rates.size();
+    writeTableHeader(out, QStringLiteral("rates"), rateRows, 3);
+    writeColumn(out, QStringLiteral("timestampUs"), rateRows,
+                [&](int row) { return rates.at(row).timestampUs; });
+    writeColumn(out, QStringLiteral("packets"), rateRows,
+                [&](int row) { return rates.at(row).packetCount; });
+    writeColumn(out, QStringLiteral("bytes"), rateRows,
+                [&](int row) { return rates.at(row).byteCount; });
+
+    QVector<quint16> ports;
+    for (int port = 0; port < PortCounters::PortCount; ++port) {
+        if (snapshot.srcPorts.count(static_cast<quint16>(port)) ||
+            snapshot.dstPorts.count(static_cast<quint16>(port))) {
+            ports.append(static_cast<quint16>(port));
+        }
+    }
+    const int portRows = ports.size();
+    writeTableHeader(out, QStringLiteral("ports"), portRows, 3);
+    writeColumn(out, QStringLiteral("port"), portRows,
+                [&](int row) { return static_cast<quint64>(ports.at(row)); });
+    writeColumn(out, QStringLiteral("sourcePackets"), portRows,
+                [&](int row) { return snapshot.srcPorts.count(ports.at(row)); });
+    writeColumn(out, QStringLiteral("destinationPackets"), portRows,
+                [&](int row) { return snapshot.dstPorts.count(ports.at(row)); });
+
+    if (out.status() != QDataStream::Ok) {
+        file.cancelWriting();
+    }
+    return file.commit();
+}
+
+bool StatisticsEngine::appendStatisticsToNdjson(const QString &filePath) const {
+    const ExportSnapshot snapshot = exportSnapshot(false);
+
+    QJsonArray protocols;
+    for (const ProtocolStats &stats : snapshot.protocols) {
+        protocols.append(protocolJson(stats));
+    }
+    QJsonArray topEndpoints;
+    for (const EndpointStats &stats : snapshot.topEndpoints) {
+        topEndpoints.append(endpointJson(stats));
+    }
+
+    QJsonObject line;
+    line["exportedUs"] = QDateTime::currentMSecsSinceEpoch() * 1000;
+    line["capture"] = captureJson(snapshot.capture);
+    line["lastInterval"] = rateJson(snapshot.lastRate);
+    line["protocols"] = protocols;
+    line["cardinality"] = cardinalityJson(snapshot.cardinality.estimate());
+    line["errors"] = jsonCount(snapshot.errors);
+    line["topEndpoints"] = topEndpoints;
+    QByteArray text = QJsonDocument(line).toJson(QJsonDocument::Compact);
+    text.append('\n');
+
+    // One write per line, so a reader tailing the file never sees half a record
+    QFile file(filePath);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Append)) {
+        return false;
+    }
+    return file.write(text) == text.size();
+}
+
+void StatisticsEngine::startRollingExport(const QString &filePath, int intervalSecs) {
+    m_rollingExportPath = filePath;
+    m_rollingTimer->start(qMax(1, intervalSecs) * 1000);
+}
+
+void StatisticsEngine::stopRollingExport() {
+    m_rollingTimer->stop();
+    m_rollingExportPath.clear();
+}
+
+void StatisticsEngine::writeRollingExport() {
+    if (m_rollingExportPath.isEmpty()) return;
+    appendStatisticsToNdjson(m_rollingExportPath);
+}
@@ -0,0 +1,314 @@
+#include "analysis/StreamReassembler.h"
+#include <algorithm>
+#include <limits>
+
+namespace {
+
+// Largest buffer data() builds: QByteArray sizes are int, less its header
+const quint64 MaxFlatBytes = static_cast<quint64>(std::numeric_limits<int>::max()) - 64;
+
+// Appends what still fits; false once the buffer is full
+bool appendClamped(QByteArray &flat, const char *data, int length) {
+    const quint64 room = MaxFlatBytes - static_cast<quint64>(flat.size());
+    flat.append(data, static_cast<int>(qMin<quint64>(room, static_cast<quint64>(length))));
+    return static_cast<quint64>(length) <= room;
+}
+
+} // namespace
+
+StreamReassembler::StreamReassembler(quint64 maxBytes)
+    : m_initialSeq(0)
+    , m_initialized(false)
+    , m_nextOffset(0)
+    , m_maxBytes(maxBytes)
+    , m_contiguousBytes(0)
+    , m_pendingBytes(0)
+    , m_truncated(false)
+{
+}
+
+void StreamReassembler::setInitialSequence(quint32 seq) {
+    clear();
+    m_initialSeq = seq;
+    m_initialized = true;
+}
+
+quint32 StreamReassembler::nextSequence() const {
+    return m_initialSeq + static_cast<quint32>(m_nextOffset);
+}
+
+qint64 StreamReassembler::toOffset(quint32 seq) const {
+    // Unwrap relative to the next expected offset; the signed 32-bit
+    // distance is correct as long as the window is below 2 GB
+    const qint32 delta = static_cast<qint32>(seq - nextSequence());
+    return static_cast<qint64>(m_nextOffset) + delta;
+}
+
+quint64 StreamReassembler::remainingBudget() const {
+    if (m_maxBytes == 0) return UINT64_MAX;
+    const quint64 used = m_contiguousBytes + m_pendingBytes;
+    return used >= m_maxBytes ? 0 : m_maxBytes - used;
+}
+
+bool StreamReassembler::isRetransmission(quint32 seq, quint32 length) const {
+    if (!m_initialized) return false;
+    return toOffset(seq) + static_cast<qint64>(length) <= static_cast<qint64>(m_nextOffset);
+}
+
+StreamReassembler::SegmentResult StreamReassembler::addSegment(quint32 seq,
+                                                               const QByteArray &buffer,
+                                                               int offset, int length) {
+    if (length <= 0 || offset < 0 || offset + length > buffer.size()) {
+        return Retransmission;
+    }
+    if (!m_initialized) {
+        setInitialSequence(seq);
+    }
+
+    qint64 start = toOffset(seq);
+    const qint64 end = start + length;
+    const qint64 next = static_cast<qint64>(m_nextOffset);
+
+    if (end <= next) {
+        return Retransmission;
+    }
+
+    // Trim the part we already have
+    if (start < next) {
+        const int trim = static_cast<int>(next - start);
+        offset += trim;
+        length -= trim;
+        start = next;
+    }
+
+    if (start == next) {
+        // Bytes buffered out of order are kept, as below; the segment only
+        // fills the holes in front of and between them
+        const qint64 segmentStart = start;
+        bool appended = false;
+        while (start < end) {
+            qint64 limit = end;
+            if (!m_pending.isEmpty()) {
+                limit = qMin(limit, static_cast<qint64>(m_pending.firstKey()));
+            }
+            const quint64 budget = remainingBudget();
+            if (budget == 0) {
+                m_truncated = true;
+                break;
+            }
+            quint64 pieceLen = static_cast<quint64>(limit - start);
+            if (pieceLen > budget) {
+                pieceLen = budget;
+                m_truncated = true;
+            }
+            appendContiguous(Chunk(buffer, offset + static_cast<int>(start - segmentStart),
+                                   static_cast<int>(pieceLen)));
+            appended = true;
+            if (pieceLen < static_cast<quint64>(limit - start)) break;
+            drainPending();
+            start = static_cast<qint64>(m_nextOffset);
+        }
+        return appended ? InOrder : Truncated;
+    }
+
+    // Out of order: split around already buffered ranges (first arrival wins)
+    QList<QPair<quint64, quint64>> pieces; // (start, end)
+    quint64 cur = static_cast<quint64>(start);
+    const quint64 segEnd = static_cast<quint64>(end);
+
+    auto it = m_pending.lowerBound(cur);
+    if (it != m_pending.begin()) {
+        auto prev = it;
+        --prev;
+        cur = qMax(cur, prev.key() + static_cast<quint64>(prev.value().length));
+    }
+    while (cur < segEnd) {
+        if (it != m_pending.end() && it.key() <= cur) {
+            cur = qMax(cur, it.key() + static_cast<quint64>(it.value().length));
+            ++it;
+            continue;
+        }
+        const quint64 limit = (it != m_pending.end() && it.key() < segEnd) ? it.key() : segEnd;
+        pieces.append(qMakePair(cur, limit));
+        cur = limit;
+    }
+
+    if (pieces.isEmpty()) {
+        return Retransmission;
+    }
+
+    bool stored = false;
+    for (const auto &piece : pieces) {
+        quint64 pieceLen = piece.second - piece.first;
+        const quint64 budget = remainingBudget();
+        if (budget == 0) {
+            m_truncated = true;
+            break;
+        }
+        if (pieceLen > budget) {
+            pieceLen = budget;
+            m_truncated = true;
+        }
+        const int pieceOffset = offset + static_cast<int>(piece.first - static_cast<quint64>(start));
+        m_pending.insert(piece.first, Chunk(buffer, pieceOffset, static_cast<int>(pieceLen)));
+        m_pendingBytes += pieceLen;
+        stored = true;
+    }
+
+    return stored ? OutOfOrder : Truncated;
+}
+
+void StreamReassembler::appendContiguous(const Chunk &chunk) {
+    m_chunks.append(chunk);
+    m_contiguousBytes += chunk.length;
+    m_nextOffset += chunk.length;
+}
+
+void StreamReassembler::drainPending() {
+    while (!m_pending.isEmpty()) {
+        auto it = m_pending.begin();
+        if (it.key() > m_nextOffset) break;
+
+        Chunk chunk = it.value();
+        const quint64 start = it.key();
+        m_pending.erase(it);
+        m_pendingBytes -= chunk.length;
+
+        const quint64 end = start + static_cast<quint64>(chunk.length);
+        if (end <= m_nextOffset) continue;
+
+        const int trim = static_cast<int>(m_nextOffset - start);
+        chunk.offset += trim;
+        chunk.length -= trim;
+        appendContiguous(chunk);
+    }
+}
+
+QList<QPair<quint32, quint32>> StreamReassembler::gaps() const {
+    QList<QPair<quint32, quint32>> result;
+    for (const auto &skipped : m_skipped) {
+        result.append(qMakePair(m_initialSeq + static_cast<quint32>(skipped.first),
+                                static_cast<quint32>(skipped.second)));
+    }
+
+    quint64 cur = m_nextOffset;
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        if (it.key() > cur) {
+            result.append(qMakePair(m_initialSeq + static_cast<quint32>(cur),
+                                    static_cast<quint32>(it.key() - cur)));
+        }
+        cur = it.key() + static_cast<quint64>(it.value().length);
+    }
+    return result;
+}
+
+void StreamReassembler::skipGaps() {
+    // Declare missing ranges lost so buffered data behind them becomes contiguous
+    while (!m_pending.isEmpty()) {
+        const quint64 start = m_pending.firstKey();
+        if (start > m_nextOffset) {
+            m_skipped.append(qMakePair(m_nextOffset, start - m_nextOffset));
+            m_nextOffset = start;
+        }
+        drainPending();
+    }
+}
+
+void StreamReassembler::merge(const StreamReassembler &other) {
+    if (!other.m_initialized || &other == this) return;
+
+    // Replay into whichever side starts first; earlier bytes would read as retransmissions
+    if (m_initialized && static_cast<qint32>(other.m_initialSeq - m_initialSeq) < 0) {
+        StreamReassembler earlier(other);
+        earlier.m_maxBytes = m_maxBytes;
+        earlier.merge(*this);
+        *this = earlier;
+        return;
+    }
+    if (!m_initialized) {
+        setInitialSequence(other.m_initialSeq);
+    }
+
+    // Contiguous data follows the initial sequence, minus the gaps that were skipped
+    quint64 streamOffset = 0;
+    int gap = 0;
+    for (const Chunk &chunk : other.m_chunks) {
+        int pos = 0;
+        while (pos < chunk.length) {
+            while (gap < other.m_skipped.size() && other.m_skipped.at(gap).first <= streamOffset) {
+                streamOffset += other.m_skipped.at(gap).second;
+                ++gap;
+            }
+            int length = chunk.length - pos;
+            if (gap < other.m_skipped.size()) {
+                length = static_cast<int>(qMin<quint64>(length, other.m_skipped.at(gap).first - streamOffset));
+            }
+            addSegment(other.m_initialSeq + static_cast<quint32>(streamOffset),
+                       chunk.buffer, chunk.offset + pos, length);
+            pos += length;
+            streamOffset += static_cast<quint64>(length);
+        }
+    }
+
+    for (auto it = other.m_pending.constBegin(); it != other.m_pending.constEnd(); ++it) {
+        addSegment(other.m_initialSeq + static_cast<quint32>(it.key()),
+                   it.value().buffer, it.value().offset, it.value().length);
+    }
+
+    m_truncated |= other.m_truncated;
+    if (!other.m_skipped.isEmpty()) {
+        skipGaps();
+    }
+}
+
+QByteArray StreamReassembler::data() const {
+    if (m_chunks.isEmpty()) return QByteArray();
+
+    // Flatten once and keep the flat buffer, releasing the packet references.
+    // An unlimited stream too large for one QByteArray is returned cut short
+    // and keeps its chunks
+    if (m_chunks.size() > 1) {
+        QByteArray flat;
+        flat.reserve(static_cast<int>(qMin(m_contiguousBytes, MaxFlatBytes)));
+        for (const Chunk &chunk : m_chunks) {
+            if (!appendClamped(flat, chunk.buffer.constData() + chunk.offset, chunk.length)) {
+                return flat;
+            }
+        }
+        m_chunks.clear();
+        m_chunks.append(Chunk(flat, 0, flat.size()));
+    }
+
+    const Chunk &chunk = m_chunks.first();
+    if (chunk.offset == 0 && chunk.length == chunk.buffer.size()) {
+        return chunk.buffer;
+    }
+    return chunk.buffer.mid(chunk.offset, chunk.length);
+}
+
+QByteArray StreamReassembler::flattenedData() const {
+    QByteArray flat = data();
+    if (m_pending.isEmpty()) return flat;
+
+    // Pending chunks never overlap; they were split around each other on arrival
+    flat.reserve(static_cast<int>(qMin(bufferedBytes(), MaxFlatBytes)));
+    for (auto it = m_pending.constBegin(); it != m_pending.constEnd(); ++it) {
+        if (!appendClamped(flat, it.value().buffer.constData() + it.value().offset,
+                           it.value().length)) {
+            break;
+        }
+    }
+    return flat;
+}
+
+void StreamReassembler::clear() {
+    m_initialSeq = 0;
+    m_initialized = false;
+    m_nextOffset = 0;
+    m_contiguousBytes = 0;
+    m_pendingBytes = 0;
+    m_truncated = false;
+    m_chunks.clear();
+    m_pending.clear();
+    m_skipped.clear();
+}
@@ -0,0 +1,48 @@
+#include "analysis/StreamTable.h"
+
+void StreamTable::clear() {
+    m_index.clear();
+    m_records.clear();
+    m_freeSlots.clear();
+}
+
+StreamTable::Record *StreamTable::find(quint32 streamIndex) {
+    auto it = m_index.constFind(streamIndex);
+    return it != m_index.constEnd() ? &m_records[it.value()] : nullptr;
+}
+
+const StreamTable::Record *StreamTable::find(quint32 streamIndex) const {
+    auto it = m_index.constFind(streamIndex);
+    return it != m_index.constEnd() ? &m_records.at(it.value()) : nullptr;
+}
+
+StreamTable::Record &StreamTable::insert(const TcpStream &stream, quint64 maxBytes) {
+    quint32 slot;
+    if (!m_freeSlots.isEmpty()) {
+        slot = m_freeSlots.takeLast();
+    } else {
+        slot = static_cast<quint32>(m_records.size());
+        m_records.append(Record());
+    }
+
+    Record &record = m_records[slot];
+    record.stream = stream;
+    record.client.setMaxBytes(maxBytes);
+    record.server.setMaxBytes(maxBytes);
+    m_index.insert(stream.streamIndex, slot);
+    return record;
+}
+
+void StreamTable::remove(quint32 streamIndex) {
+    auto it = m_index.find(streamIndex);
+    if (it == m_index.end()) return;
+
+    // Release stream data and packet references now; the slot is reused
+    Record &record = m_records[it.value()];
+    record.stream = TcpStream();
+    record.client.clear();
+    record.server.clear();
+    record.analyzer.clear();
+    m_freeSlots.append(it.value());
+    m_index.erase(it);
+}
@@ -0,0 +1,127 @@
+#include "analysis/SymbolTable.h"
+#include <QReadLocker>
+#include <QWriteLocker>
+#include <utility>
+
+const quint32 SymbolTable::EmptyId;
+
+SymbolTable::SymbolTable() {
+    m_ids.insert(QString(), EmptyId);
+    m_names.append(QString());
+    m_references.append(0);
+}
+
+quint32 SymbolTable::acquire(const QString &name) {
+    if (name.isEmpty()) return EmptyId;
+
+    QWriteLocker locker(&m_lock);
+    auto it = m_ids.constFind(name);
+    if (it != m_ids.constEnd()) {
+        m_references[static_cast<int>(it.value())]++;
+        return it.value();
+    }
+
+    quint32 id = 0;
+    if (!m_freeIds.isEmpty()) {
+        id = m_freeIds.takeLast();
+        m_names[static_cast<int>(id)] = name;
+        m_references[static_cast<int>(id)] = 1;
+    } else {
+        id = static_cast<quint32>(m_names.size());
+        m_names.append(name);
+        m_references.append(1);
+    }
+    m_ids.insert(name, id);
+    return id;
+}
+
+void SymbolTable::release(quint32 id) {
+    if (id == EmptyId) return;
+
+    QWriteLocker locker(&m_lock);
+    if (id >= static_cast<quint32>(m_names.size())) return;
+    quint32 &references = m_references[static_cast<int>(id)];
+    if (references == 0 || --references > 0) return;
+
+    m_ids.remove(m_names.at(static_cast<int>(id)));
+    m_names[static_cast<int>(id)] = QString();
+    m_freeIds.append(id);
+}
+
+bool SymbolTable::lookup(const QString &name, quint32 *id) const {
+    if (name.isEmpty()) {
+        *id = EmptyId;
+        return true;
+    }
+
+    QReadLocker locker(&m_lock);
+    auto it = m_ids.constFind(name);
+    if (it == m_ids.constEnd()) return false;
+    *id = it.value();
+    return true;
+}
+
+QString SymbolTable::name(quint32 id) const {
+    QReadLocker locker(&m_lock);
+    return id < static_cast<quint32>(m_names.size()) ? m_names.at(static_cast<int>(id)) : QString();
+}
+
+int SymbolTable::size() const {
+    QReadLocker locker(&m_lock);
+    return m_ids.size();
+}
+
+quint64 SymbolTable::key(const QString &name) {
+    if (name.isEmpty()) return 0;
+
+    // FNV-1a over the UTF-16 code units; fixed, unlike qHash's per-process seed
+    quint64 hash = 14695981039346656037ULL;
+    const QChar *data = name.constData();
+    for (int i = 0; i < name.size(); ++i) {
+        hash = (hash ^ data[i].unicode()) * 1099511628211ULL;
+    }
+    return hash ? hash : 1;
+}
+
+SymbolCache::SymbolCache(SymbolTable *table)
+    : m_table(table)
+{
+}
+
+SymbolCache::~SymbolCache() {
+    clear();
+}
+
+Symbol SymbolCache::intern(const QString &name) {
+    if (name.isEmpty()) return Symbol();
+
+    auto it = m_symbols.constFind(name);
+    if (it != m_symbols.constEnd()) {
+        return it.value();
+    }
+
+    Symbol symbol;
+    symbol.id = m_table->acquire(name);
+    symbol.key = SymbolTable::key(name);
+    m_symbols.insert(name, symbol);
+    return symbol;
+}
+
+void SymbolCache::forget(const QString &name) {
+    auto it = m_symbols.find(name);
+    if (it == m_symbols.end()) return;
+    m_table->release(it.value().id);
+    m_symbols.erase(it);
+}
+
+void SymbolCache::clear() {
+    for (auto it = m_symbols.constBegin(); it != m_symbols.constEnd(); ++it) {
+        m_table->release(it.value().id);
+    }
+    m_symbols.clear();
+}
+
+void SymbolCache::swap(SymbolCache &other) {
+    std::swap(m_table, other.m_table);
+    m_symbols.swap(other.m_symbols);
+}
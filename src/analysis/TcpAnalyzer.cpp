@@ -0,0 +1,243 @@
+#include "analysis/TcpAnalyzer.h"
+#include "analysis/TcpHeader.h"
+
+namespace {
+
+// Reordering window when the stream's round trip is not known yet, and its
+// floor: round trips are measured no finer than the capture's timestamps
+const qint64 DefaultReorderUs = 3000;
+
+inline bool seqAfter(quint32 a, quint32 b) {
+    return static_cast<qint32>(a - b) > 0;
+}
+
+// A late segment within one round trip of the highest one was reordered;
+// a retransmission needs at least a round trip to be triggered
+qint64 reorderWindowUs(const TcpMetrics &metrics) {
+    if (metrics.handshakeRttUs > 0) return qMax(metrics.handshakeRttUs, DefaultReorderUs);
+    if (metrics.client.rtt.smoothedUs >= 0 && metrics.server.rtt.smoothedUs >= 0) {
+        return qMax(metrics.client.rtt.smoothedUs + metrics.server.rtt.smoothedUs, DefaultReorderUs);
+    }
+    return DefaultReorderUs;
+}
+
+void addRttSample(TcpRttStats &rtt, qint64 sampleUs) {
+    if (rtt.samples == 0) {
+        rtt.minUs = sampleUs;
+        rtt.maxUs = sampleUs;
+        rtt.smoothedUs = sampleUs;
+        rtt.variationUs = sampleUs / 2;
+    } else {
+        rtt.minUs = qMin(rtt.minUs, sampleUs);
+        rtt.maxUs = qMax(rtt.maxUs, sampleUs);
+        rtt.variationUs = (3 * rtt.variationUs + qAbs(rtt.smoothedUs - sampleUs)) / 4;
+        rtt.smoothedUs = (7 * rtt.smoothedUs + sampleUs) / 8;
+    }
+    rtt.lastUs = sampleUs;
+    rtt.samples++;
+}
+
+void mergeRtt(TcpRttStats &into, const TcpRttStats &from) {
+    if (from.samples == 0) return;
+    if (into.samples == 0) {
+        into = from;
+        return;
+    }
+    const double total = static_cast<double>(into.samples + from.samples);
+    const double weight = from.samples / total;
+    into.minUs = qMin(into.minUs, from.minUs);
+    into.maxUs = qMax(into.maxUs, from.maxUs);
+    into.smoothedUs += qRound64((from.smoothedUs - into.smoothedUs) * weight);
+    into.variationUs += qRound64((from.variationUs - into.variationUs) * weight);
+    into.samples += from.samples;
+}
+
+void mergeDirection(TcpDirectionMetrics &into, const TcpDirectionMetrics &from) {
+    mergeRtt(into.rtt, from.rtt);
+    into.goodputBytes += from.goodputBytes;
+    into.retransmissions += from.retransmissions;
+    into.outOfOrder += from.outOfOrder;
+    into.duplicateAcks += from.duplicateAcks;
+    into.zeroWindows += from.zeroWindows;
+}
+
+void recordGoodput(TcpMetrics &metrics, qint64 startUs, qint64 timeUs, quint64 bytes) {
+    if (metrics.goodputIntervalUs <= 0) {
+        metrics.goodputIntervalUs = TcpAnalyzer::InitialGoodputIntervalUs;
+    }
+    const qint64 offsetUs = qMax<qint64>(0, timeUs - startUs);
+    while (offsetUs / metrics.goodputIntervalUs >= TcpAnalyzer::GoodputBuckets) {
+        // Halve the resolution: pairs of buckets fold into one
+        const int size = metrics.goodput.size();
+        for (int i = 0; i < size; i += 2) {
+            const quint64 next = (i + 1 < size) ? metrics.goodput.at(i + 1) : 0;
+            metrics.goodput[i / 2] = metrics.goodput.at(i) + next;
+        }
+        metrics.goodput.resize((size + 1) / 2);
+        metrics.goodputIntervalUs *= 2;
+    }
+
+    const int bucket = static_cast<int>(offsetUs / metrics.goodputIntervalUs);
+    if (bucket >= metrics.goodput.size()) {
+        metrics.goodput.resize(bucket + 1);
+    }
+    metrics.goodput[bucket] += bytes;
+}
+
+} // namespace
+
+TcpAnalyzer::Direction::Direction()
+    : highestSeq(0), highestUs(0), ackedSeq(0), lastAck(0), lastWindow(0), timedSeq(0),
+      timedUs(0), synUs(-1), seqValid(false), ackedValid(false), ackValid(false),
+      timing(false), timedSyn(false), zeroWindow(false)
+{
+}
+
+TcpAnalyzer::TcpAnalyzer()
+{
+}
+
+void TcpAnalyzer::clear() {
+    m_client = Direction();
+    m_server = Direction();
+}
+
+TcpAnalyzer::Segment TcpAnalyzer::addSegment(TcpStream &stream, bool clientToServer,
+                                             qint64 timeUs, const TcpHeader &tcp) {
+    // A reset's sequence and window say nothing about the connection's health
+    if (tcp.has(TcpHeader::Rst)) return NoData;
+
+    Direction &sender = clientToServer ? m_client : m_server;
+    Direction &peer = clientToServer ? m_server : m_client;
+    TcpDirectionMetrics &metrics = clientToServer ? stream.metrics.client : stream.metrics.server;
+
+    const Segment segment = classify(sender, metrics, timeUs, tcp, reorderWindowUs(stream.metrics));
+    if (segment == Retransmission) {
+        stream.retransmissions++;
+    } else if (segment == OutOfOrder) {
+        stream.outOfOrder++;
+    }
+
+    if (tcp.window == 0 && !tcp.has(TcpHeader::Syn)) {
+        if (!sender.zeroWindow) metrics.zeroWindows++;
+        sender.zeroWindow = true;
+    } else {
+        sender.zeroWindow = false;
+    }
+
+    if (tcp.has(TcpHeader::Ack)) {
+        acknowledge(stream, clientToServer, sender, peer, timeUs, tcp);
+    }
+    return segment;
+}
+
+TcpAnalyzer::Segment TcpAnalyzer::classify(Direction &sender, TcpDirectionMetrics &metrics,
+                                           qint64 timeUs, const TcpHeader &tcp,
+                                           qint64 reorderUs) {
+    // SYN and FIN each take one sequence number
+    const bool syn = tcp.has(TcpHeader::Syn);
+    const bool fin = tcp.has(TcpHeader::Fin);
+    const quint32 length = tcp.payloadLength + (syn ? 1 : 0) + (fin ? 1 : 0);
+    if (length == 0) return NoData;
+
+    const quint32 seqEnd = tcp.seq + length;
+    if (syn) {
+        sender.synUs = timeUs;           // The handshake is timed from the last SYN sent
+    }
+
+    if (!sender.seqValid || seqAfter(seqEnd, sender.highestSeq)) {
+        sender.seqValid = true;
+        sender.highestSeq = seqEnd;
+        sender.highestUs = timeUs;
+        if (!sender.timing) {
+            sender.timing = true;
+            sender.timedSeq = seqEnd;
+            sender.timedUs = timeUs;
+            sender.timedSyn = syn;
+        }
+        return NewData;
+    }
+
+    if (tcp.payloadLength == 1 && !syn && !fin && tcp.seq + 1 == sender.highestSeq &&
+        timeUs - sender.highestUs >= reorderUs) {
+        return KeepAlive;
+    }
+    if (!syn && timeUs - sender.highestUs < reorderUs) {
+        metrics.outOfOrder++;
+        return OutOfOrder;
+    }
+
+    metrics.retransmissions++;
+    sender.timing = false;
+    return Retransmission;
+}
+
+void TcpAnalyzer::acknowledge(TcpStream &stream, bool clientToServer, Direction &sender,
+                              Direction &peer, qint64 timeUs, const TcpHeader &tcp) {
+    TcpMetrics &metrics = stream.metrics;
+    TcpDirectionMetrics &senderMetrics = clientToServer ? metrics.client : metrics.server;
+    TcpDirectionMetrics &peerMetrics = clientToServer ? metrics.server : metrics.client;
+    const quint32 ack = tcp.ack;
+
+    const bool pureAck = tcp.payloadLength == 0 && !tcp.has(TcpHeader::Syn) &&
+                         !tcp.has(TcpHeader::Fin);
+    if (pureAck && sender.ackValid && ack == sender.lastAck && tcp.window == sender.lastWindow &&
+        peer.seqValid && seqAfter(peer.highestSeq, ack)) {
+        senderMetrics.duplicateAcks++;
+    }
+    if (!sender.ackValid || !seqAfter(sender.lastAck, ack)) {
+        sender.lastAck = ack;
+        sender.lastWindow = tcp.window;
+        sender.ackValid = true;
+    }
+
+    // Goodput counts from the first ACK seen; data acknowledged before it is unknown
+    if (!peer.ackedValid) {
+        peer.ackedSeq = ack;
+        peer.ackedValid = true;
+    } else if (seqAfter(ack, peer.ackedSeq)) {
+        const quint64 bytes = ack - peer.ackedSeq;
+        peer.ackedSeq = ack;
+        peerMetrics.goodputBytes += bytes;
+        recordGoodput(metrics, stream.startTimeUs, timeUs, bytes);
+    }
+
+    if (peer.timing && !seqAfter(peer.timedSeq, ack)) {
+        peer.timing = false;
+        // A zero sample only says the capture's clock did not tick; it is unknown
+        const qint64 sampleUs = timeUs - peer.timedUs;
+        if (sampleUs > 0) {
+            addRttSample(peerMetrics.rtt, sampleUs);
+            // The client acknowledging the SYN-ACK completes the handshake
+            if (peer.timedSyn && clientToServer && sender.synUs >= 0 &&
+                timeUs > sender.synUs && metrics.handshakeRttUs < 0) {
+                metrics.handshakeRttUs = timeUs - sender.synUs;
+            }
+        }
+    }
+}
+
+void TcpAnalyzer::mergeMetrics(TcpMetrics &into, qint64 intoStartUs, const TcpMetrics &from,
+                               qint64 fromStartUs) {
+    if (into.handshakeRttUs < 0) {
+        into.handshakeRttUs = from.handshakeRttUs;
+    }
+    mergeDirection(into.client, from.client);
+    mergeDirection(into.server, from.server);
+
+    if (from.goodput.isEmpty()) return;
+    const qint64 startUs = into.goodput.isEmpty() ? fromStartUs : qMin(intoStartUs, fromStartUs);
+    TcpMetrics series;
+    series.goodputIntervalUs = qMax(into.goodputIntervalUs, from.goodputIntervalUs);
+    auto rebucket = [&](const TcpMetrics &metrics, qint64 seriesStartUs) {
+        for (int i = 0; i < metrics.goodput.size(); ++i) {
+            if (metrics.goodput.at(i) == 0) continue;
+            recordGoodput(series, startUs, seriesStartUs + i * metrics.goodputIntervalUs,
+                          metrics.goodput.at(i));
+        }
+    };
+    rebucket(into, intoStartUs);
+    rebucket(from, fromStartUs);
+    into.goodputIntervalUs = series.goodputIntervalUs;
+    into.goodput = series.goodput;
+}
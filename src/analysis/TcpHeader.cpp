@@ -0,0 +1,186 @@
+#include "analysis/TcpHeader.h"
+
+namespace {
+
+const quint16 EtherTypeIPv4 = 0x0800;
+const quint16 EtherTypeIPv6 = 0x86DD;
+const quint16 EtherTypeVlan = 0x8100;
+const quint16 EtherTypeQinQ = 0x88A8;
+const quint8 IpProtoTcp = 6;
+const quint8 IpProtoUdp = 17;
+
+inline quint16 readBE16(const uchar *p) {
+    return static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+inline quint32 readBE32(const uchar *p) {
+    return (static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) |
+           (static_cast<quint32>(p[2]) << 8) | static_cast<quint32>(p[3]);
+}
+
+// Locate the transport header behind an IP header at ipOffset; returns its
+// offset and the end of the IP payload, or false for another IP protocol
+bool locateTransport(const uchar *data, int size, int ipOffset, quint8 ipProtocol,
+                     int *transportOffset, int *ipEnd) {
+    if (ipOffset >= size) return false;
+    const int version = data[ipOffset] >> 4;
+
+    if (version == 4) {
+        if (ipOffset + 20 > size) return false;
+        const int ihl = (data[ipOffset] & 0x0F) * 4;
+        if (ihl < 20 || data[ipOffset + 9] != ipProtocol) return false;
+        if (readBE16(data + ipOffset + 6) & 0x1FFF) return false; // Non-first fragment
+        *transportOffset = ipOffset + ihl;
+        *ipEnd = ipOffset + readBE16(data + ipOffset + 2);
+        return true;
+    }
+
+    if (version == 6) {
+        if (ipOffset + 40 > size) return false;
+        *ipEnd = ipOffset + 40 + readBE16(data + ipOffset + 4);
+        quint8 next = data[ipOffset + 6];
+        int offset = ipOffset + 40;
+        // Hop-by-hop, routing and destination options extension headers
+        while (next == 0 || next == 43 || next == 60) {
+            if (offset + 8 > size) return false;
+            next = data[offset];
+            offset += (data[offset + 1] + 1) * 8;
+        }
+        if (next != ipProtocol) return false;
+        *transportOffset = offset;
+        return true;
+    }
+
+    return false;
+}
+
+// Candidate IP header positions, most common link type first
+int ipHeaderCandidates(const uchar *data, int size, int candidates[3]) {
+    int count = 0;
+    if (size >= 14) {
+        int offset = 12;
+        quint16 etherType = readBE16(data + offset);
+        while ((etherType == EtherTypeVlan || etherType == EtherTypeQinQ) && offset + 6 <= size) {
+            offset += 4;
+            etherType = readBE16(data + offset);
+        }
+        if (etherType == EtherTypeIPv4 || etherType == EtherTypeIPv6) {
+            candidates[count++] = offset + 2;
+        }
+    }
+    if (size >= 16) {
+        const quint16 protocol = readBE16(data + 14); // Linux cooked capture
+        if (protocol == EtherTypeIPv4 || protocol == EtherTypeIPv6) {
+            candidates[count++] = 16;
+        }
+    }
+    candidates[count++] = 0; // Raw IP
+    return count;
+}
+
+} // namespace
+
+TcpHeader TcpHeader::fromPacket(const PacketModel &packet) {
+    TcpHeader header;
+    if (!decodeRaw(packet, &header)) {
+        decodeFields(packet, &header);
+    }
+    return header;
+}
+
+bool TcpHeader::decodeRaw(const PacketModel &packet, TcpHeader *header) {
+    const uchar *data = reinterpret_cast<const uchar *>(packet.rawData.constData());
+    const int size = packet.rawData.size();
+
+    int candidates[3];
+    const int candidateCount = ipHeaderCandidates(data, size, candidates);
+
+    for (int i = 0; i < candidateCount; ++i) {
+        int tcp = 0;
+        int ipEnd = 0;
+        if (!locateTransport(data, size, candidates[i], IpProtoTcp, &tcp, &ipEnd)) continue;
+        if (tcp + 20 > size) continue;
+
+        // The ports must agree with the dissector, which rules out false matches
+        if (readBE16(data + tcp) != packet.srcPort || readBE16(data + tcp + 2) != packet.dstPort) {
+            continue;
+        }
+        const int dataOffset = (data[tcp + 12] >> 4) * 4;
+        if (dataOffset < 20 || ipEnd < tcp + dataOffset) continue;
+
+        header->seq = readBE32(data + tcp + 4);
+        header->ack = readBE32(data + tcp + 8);
+        header->flags = data[tcp + 13];
+        header->window = readBE16(data + tcp + 14);
+        header->payloadLength = static_cast<quint32>(ipEnd - tcp - dataOffset);
+        // Ethernet padding lies beyond ipEnd; a snapped frame ends before it
+        header->payloadOffset = (ipEnd <= size) ? tcp + dataOffset : -1;
+        header->valid = true;
+        return true;
+    }
+    return false;
+}
+
+void TcpHeader::decodeFields(const PacketModel &packet, TcpHeader *header) {
+    const auto &fields = packet.customFields;
+    const auto end = fields.constEnd();
+    auto it = fields.constFind("tcp.seq");
+    if (it == end) return;
+
+    header->seq = it.value().toUInt();
+    header->valid = true;
+    if ((it = fields.constFind("tcp.ack")) != end) header->ack = it.value().toUInt();
+    if ((it = fields.constFind("tcp.len")) != end) header->payloadLength = it.value().toUInt();
+    if ((it = fields.constFind("tcp.window_size")) != end) {
+        header->window = static_cast<quint16>(it.value().toUInt());
+    }
+
+    static const struct {
+        const char *name;
+        Flag flag;
+    } flagFields[] = {
+        {"tcp.flags.fin", Fin}, {"tcp.flags.syn", Syn}, {"tcp.flags.rst", Rst},
+        {"tcp.flags.push", Psh}, {"tcp.flags.ack", Ack}, {"tcp.flags.urg", Urg}
+    };
+    for (const auto &field : flagFields) {
+        it = fields.constFind(QLatin1String(field.name));
+        if (it != end && it.value().toBool()) {
+            header->flags |= field.flag;
+        }
+    }
+
+    // Payload is the trailing tcp.len bytes unless the dissector recorded
+    // an explicit offset (needed for frames with Ethernet padding)
+    const int size = packet.rawData.size();
+    const int len = static_cast<int>(header->payloadLength);
+    it = fields.constFind("tcp.payload_offset");
+    const int offset = (it != end) ? it.value().toInt() : size - len;
+    header->payloadOffset = (offset >= 0 && offset + len <= size) ? offset : -1;
+}
+
+UdpHeader UdpHeader::fromPacket(const PacketModel &packet) {
+    UdpHeader header;
+    const uchar *data = reinterpret_cast<const uchar *>(packet.rawData.constData());
+    const int size = packet.rawData.size();
+
+    int candidates[3];
+    const int candidateCount = ipHeaderCandidates(data, size, candidates);
+
+    for (int i = 0; i < candidateCount; ++i) {
+        int udp = 0;
+        int ipEnd = 0;
+        if (!locateTransport(data, size, candidates[i], IpProtoUdp, &udp, &ipEnd)) continue;
+        if (udp + 8 > size) continue;
+        if (readBE16(data + udp) != packet.srcPort || readBE16(data + udp + 2) != packet.dstPort) {
+            continue;
+        }
+        const int length = readBE16(data + udp + 4);
+        if (length < 8 || udp + length > ipEnd) continue;
+
+        header.payloadLength = static_cast<quint32>(length - 8);
+        header.payloadOffset = (udp + length <= size) ? udp + 8 : -1;
+        header.valid = true;
+        return header;
+    }
+    return header;
+}